@@ -0,0 +1,44 @@
+# entityx_python_bundle(<target> <output> <source directory>...)
+#
+# Add a target that compiles the Python modules and packages in the source
+# directories into a zip bundle of bytecode, to be loaded with
+# PythonSystem::add_bundle(). The bytecode is compiled by PYTHON_EXECUTABLE,
+# which must be the same version as the embedded interpreter.
+#
+# entityx_python_find_interpreter()
+#
+# Find PYTHON_EXECUTABLE with the major.minor version of the embedded
+# PythonLibs, failing configuration if it differs. The interpreter is only
+# looked for when this is called, by entityx_python_bundle() or before
+# freezing the entityx package.
+
+macro(entityx_python_find_interpreter)
+    if(NOT PYTHONLIBS_VERSION_STRING)
+        find_package(PythonLibs 2.7 REQUIRED)
+    endif()
+    string(REGEX MATCH "^[0-9]+\\.[0-9]+" ENTITYX_PYTHON_LIBS_VERSION "${PYTHONLIBS_VERSION_STRING}")
+    find_package(PythonInterp ${ENTITYX_PYTHON_LIBS_VERSION} EXACT REQUIRED)
+    if(NOT "${PYTHON_VERSION_MAJOR}.${PYTHON_VERSION_MINOR}" VERSION_EQUAL "${ENTITYX_PYTHON_LIBS_VERSION}")
+        message(FATAL_ERROR "Python interpreter ${PYTHON_EXECUTABLE} (${PYTHON_VERSION_STRING}) does not match "
+                            "the embedded Python libraries (${PYTHONLIBS_VERSION_STRING}). Set PYTHON_EXECUTABLE "
+                            "to a Python ${ENTITYX_PYTHON_LIBS_VERSION} interpreter.")
+    endif()
+endmacro()
+
+set(ENTITYX_PYTHON_BUNDLE_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/entityx_python_bundle.py)
+
+function(entityx_python_bundle TARGET OUTPUT)
+    entityx_python_find_interpreter()
+    set(scripts)
+    foreach(source ${ARGN})
+        file(GLOB_RECURSE source_scripts ${source}/*.py)
+        list(APPEND scripts ${source_scripts})
+    endforeach()
+    add_custom_command(
+        OUTPUT ${OUTPUT}
+        COMMAND ${PYTHON_EXECUTABLE} ${ENTITYX_PYTHON_BUNDLE_SCRIPT} ${OUTPUT} ${ARGN}
+        DEPENDS ${ENTITYX_PYTHON_BUNDLE_SCRIPT} ${scripts}
+        COMMENT "Bundling Python scripts into ${OUTPUT}"
+        )
+    add_custom_target(${TARGET} ALL DEPENDS ${OUTPUT})
+endfunction()
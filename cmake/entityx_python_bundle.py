@@ -0,0 +1,60 @@
+"""Compile Python script trees into a zip bundle for PythonSystem::add_bundle().
+
+    python entityx_python_bundle.py <output.zip> <source directory>...
+
+Each module and package in the source directories is compiled, and stored in
+the bundle as bytecode only. The bundle must be built with the same Python
+version as the embedded interpreter.
+"""
+
+import marshal
+import os
+import struct
+import sys
+import time
+import zipfile
+
+try:
+    from importlib.util import MAGIC_NUMBER
+except ImportError:
+    from imp import get_magic
+    MAGIC_NUMBER = get_magic()
+
+
+def _pyc(source, filename, mtime):
+    code = compile(source, filename, 'exec')
+    data = marshal.dumps(code)
+    mtime = int(mtime) & 0xFFFFFFFF
+    if sys.version_info >= (3, 7):
+        return MAGIC_NUMBER + struct.pack('<III', 0, mtime, len(source) & 0xFFFFFFFF) + data
+    if sys.version_info >= (3, 3):
+        return MAGIC_NUMBER + struct.pack('<II', mtime, len(source) & 0xFFFFFFFF) + data
+    return MAGIC_NUMBER + struct.pack('<I', mtime) + data
+
+
+def bundle(output, sources):
+    with zipfile.ZipFile(output, 'w', zipfile.ZIP_DEFLATED) as archive:
+        for source in sources:
+            for root, dirs, files in os.walk(source):
+                dirs.sort()
+                relative = os.path.relpath(root, source)
+                if relative != os.curdir and not os.path.exists(os.path.join(root, '__init__.py')):
+                    # Not a package, so not importable.
+                    dirs[:] = []
+                    continue
+                for name in sorted(files):
+                    if not name.endswith('.py'):
+                        continue
+                    path = os.path.join(root, name)
+                    arcname = os.path.normpath(os.path.join(relative, name)).replace(os.sep, '/')
+                    with open(path, 'rb') as f:
+                        source_code = f.read()
+                    info = zipfile.ZipInfo(arcname + 'c', time.localtime(os.path.getmtime(path))[:6])
+                    info.compress_type = zipfile.ZIP_DEFLATED
+                    archive.writestr(info, _pyc(source_code, arcname, os.path.getmtime(path)))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    bundle(sys.argv[1], sys.argv[2:])
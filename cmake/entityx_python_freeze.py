@@ -0,0 +1,82 @@
+"""Compile the entityx Python package into C++ source for a frozen import.
+
+    python entityx_python_freeze.py <output.cc> <package directory>
+
+The top-level modules of the package are compiled to bytecode and written
+out as entityx::python::detail::frozen_modules, which PythonSystem registers
+with the interpreter before it is initialized. Subpackages (such as tests)
+are left on disk. The bytecode must be generated by the same Python version
+as the embedded interpreter.
+"""
+
+import marshal
+import os
+import sys
+
+
+HEADER = '''\
+// Generated by entityx_python_freeze.py from %(package)s. Do not edit.
+
+#include "entityx/python/PythonSystem.h"
+
+namespace entityx {
+namespace python {
+namespace detail {
+'''
+
+FOOTER = '''\
+}  // namespace detail
+}  // namespace python
+}  // namespace entityx
+'''
+
+
+def _array(name, data):
+    if not isinstance(data, bytearray):
+        data = bytearray(data)
+    lines = ['static const unsigned char %s[] = {' % name]
+    for offset in range(0, len(data), 16):
+        lines.append('  ' + ' '.join('%d,' % byte for byte in data[offset:offset + 16]))
+    lines.append('};')
+    return '\n'.join(lines) + '\n'
+
+
+def freeze(output, package_dir):
+    package_dir = os.path.normpath(package_dir)
+    package = os.path.basename(package_dir)
+    modules = []
+    for name in sorted(os.listdir(package_dir)):
+        if not name.endswith('.py'):
+            continue
+        module = name[:-3]
+        is_package = module == '__init__'
+        fullname = package if is_package else '%s.%s' % (package, module)
+        with open(os.path.join(package_dir, name), 'rb') as f:
+            source = f.read()
+        code = compile(source, '%s/%s' % (package, name), 'exec')
+        modules.append((fullname, is_package, marshal.dumps(code)))
+
+    chunks = [HEADER % {'package': package}]
+    for index, (fullname, is_package, data) in enumerate(modules):
+        chunks.append('\n' + _array('frozen_%d' % index, data))
+    chunks.append('\nextern const FrozenModule frozen_modules[] = {\n')
+    for index, (fullname, is_package, data) in enumerate(modules):
+        chunks.append('  {"%s", frozen_%d, sizeof(frozen_%d), %s},\n' % (
+            fullname, index, index, 'true' if is_package else 'false'))
+    chunks.append('  {nullptr, nullptr, 0, false},\n};\n\n')
+    chunks.append(FOOTER)
+
+    source = ''.join(chunks)
+    # Leave an unchanged file alone so that the library is not rebuilt.
+    if os.path.exists(output):
+        with open(output) as f:
+            if f.read() == source:
+                return
+    with open(output, 'w') as f:
+        f.write(source)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    freeze(sys.argv[1], sys.argv[2])
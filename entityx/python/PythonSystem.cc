@@ -10,10 +10,17 @@
 
  // http://docs.python.org/2/extending/extending.html
 #include <boost/python.hpp>
+#include <boost/python/object/find_instance.hpp>
 #include <boost/noncopyable.hpp>
+#include <structmember.h>
 #include <cassert>
 #include <string>
 #include <iostream>
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+#include <fstream>
+#include <iomanip>
 #include <sstream>
 #include "entityx/python/PythonSystem.h"
 #include "entityx/python/config.h"
@@ -28,15 +35,20 @@ class PythonEntityXLogger {
 public:
   PythonEntityXLogger() {}
   explicit PythonEntityXLogger(PythonSystem::LoggerFunction logger) : logger_(logger) {}
-  ~PythonEntityXLogger() { flush(true); }
+  ~PythonEntityXLogger() { write_lines(true); }
 
   void write(const std::string &text) {
     line_ += text;
-    flush();
+    write_lines();
   }
 
+  // Complete lines are logged as they are written, and a partial line is
+  // held until it is completed, so there is nothing to flush. Defined for
+  // callers of sys.stdout.flush(), such as multiprocessing.
+  void flush() {}
+
 private:
-  void flush(bool force = false) {
+  void write_lines(bool force = false) {
     size_t offset;
     while ( (offset = line_.find('\n')) != std::string::npos ) {
       std::string text = line_.substr(0, offset);
@@ -57,10 +69,15 @@ private:
  * Base class for Python entities.
  */
 struct PythonEntity {
-  explicit PythonEntity(EntityManager* entity_manager, Entity::Id id) : _entity(Entity(entity_manager, id)) {}  // NOLINT
+  explicit PythonEntity(EntityManager* entity_manager, Entity::Id id)  // NOLINT
+    : _entity(Entity(entity_manager, id)), _entity_manager(entity_manager) {}
   virtual ~PythonEntity() {}
 
   void destroy() {
+    if ( CommandBuffer *commands = CommandBuffer::recording_for(*_entity_manager) ) {
+      commands->destroy(_entity.id());
+      return;
+    }
     _entity.destroy();
   }
 
@@ -72,9 +89,155 @@ struct PythonEntity {
     return _entity.id();
   }
 
+  // Bind a pooled instance to a newly created entity.
+  void _rebind(EntityManager* entity_manager, Entity::Id id) {
+    _entity = Entity(entity_manager, id);
+    _entity_manager = entity_manager;
+  }
+
   Entity _entity;
+  EntityManager* _entity_manager;
+  // Values of attributes declared in the Python class' __slots__. Indexed by
+  // PythonEntitySlot::index.
+  std::vector<py::handle<>> _slots;
+};
+
+/**
+ * Data descriptor for an attribute declared in an entity class' __slots__.
+ *
+ * CPython does not allow non-empty __slots__ on subclasses of Boost.Python
+ * classes, so EntityMetaClass replaces each declared name with one of these
+ * and the value is stored in PythonEntity::_slots instead of the instance
+ * __dict__. It is a native type rather than a Boost.Python class so that
+ * attribute access does not go through Boost.Python's call dispatch.
+ */
+struct PythonEntitySlot {
+  PyObject_HEAD
+  Py_ssize_t index;
+  PyObject *name;
+};
+
+// Shallow-copy the instance state of prototype (slots and __dict__) into self.
+static void PythonEntity_copy_state(py::object self, py::object prototype) {
+  PythonEntity &entity = py::extract<PythonEntity&>(self);
+  const PythonEntity &source = py::extract<const PythonEntity&>(prototype);
+  entity._slots = source._slots;
+  PyObject **source_dict = _PyObject_GetDictPtr(prototype.ptr());
+  if ( source_dict && *source_dict ) {
+    PyObject *dict = PyDict_Copy(*source_dict);
+    if ( !dict ) {
+      py::throw_error_already_set();
+    }
+    PyObject **target_dict = _PyObject_GetDictPtr(self.ptr());
+    Py_XDECREF(*target_dict);
+    *target_dict = dict;
+  }
+}
+
+// The PythonEntity held by instance, or nullptr with TypeError set.
+static PythonEntity *PythonEntitySlot_entity(PyObject *instance) {
+  void *entity = py::objects::find_instance_impl(instance, py::type_id<PythonEntity>());
+  if ( !entity ) {
+    PyErr_Format(PyExc_TypeError, "slot descriptors only apply to entityx.Entity instances, not '%.200s'",
+                 Py_TYPE(instance)->tp_name);
+  }
+  return static_cast<PythonEntity*>(entity);
+}
+
+static PyObject *PythonEntitySlot_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+  Py_ssize_t index;
+  PyObject *name;
+  static const char *keywords[] = {"index", "name", nullptr};
+  if ( !PyArg_ParseTupleAndKeywords(args, kwargs, "nO:Slot", const_cast<char**>(keywords), &index, &name) ) {
+    return nullptr;
+  }
+  if ( index < 0 ) {
+    PyErr_SetString(PyExc_ValueError, "slot index must not be negative");
+    return nullptr;
+  }
+  PythonEntitySlot *slot = reinterpret_cast<PythonEntitySlot*>(type->tp_alloc(type, 0));
+  if ( slot ) {
+    slot->index = index;
+    Py_INCREF(name);
+    slot->name = name;
+  }
+  return reinterpret_cast<PyObject*>(slot);
+}
+
+static void PythonEntitySlot_dealloc(PyObject *self) {
+  Py_XDECREF(reinterpret_cast<PythonEntitySlot*>(self)->name);
+  Py_TYPE(self)->tp_free(self);
+}
+
+static PyObject *PythonEntitySlot_get(PyObject *self, PyObject *instance, PyObject *owner) {
+  if ( !instance || instance == Py_None ) {
+    Py_INCREF(self);
+    return self;
+  }
+  const PythonEntitySlot *slot = reinterpret_cast<PythonEntitySlot*>(self);
+  PythonEntity *entity = PythonEntitySlot_entity(instance);
+  if ( !entity ) {
+    return nullptr;
+  }
+  const size_t index = slot->index;
+  if ( index >= entity->_slots.size() || !entity->_slots[index] ) {
+    PyErr_SetObject(PyExc_AttributeError, slot->name);
+    return nullptr;
+  }
+  return py::incref(entity->_slots[index].get());
+}
+
+// Set the slot, or delete it if value is null.
+static int PythonEntitySlot_set(PyObject *self, PyObject *instance, PyObject *value) {
+  const PythonEntitySlot *slot = reinterpret_cast<PythonEntitySlot*>(self);
+  PythonEntity *entity = PythonEntitySlot_entity(instance);
+  if ( !entity ) {
+    return -1;
+  }
+  const size_t index = slot->index;
+  if ( !value ) {
+    if ( index >= entity->_slots.size() || !entity->_slots[index] ) {
+      PyErr_SetObject(PyExc_AttributeError, slot->name);
+      return -1;
+    }
+    entity->_slots[index].reset();
+    return 0;
+  }
+  if ( index >= entity->_slots.size() ) {
+    entity->_slots.resize(index + 1);
+  }
+  entity->_slots[index] = py::handle<>(py::borrowed(value));
+  return 0;
+}
+
+static PyMemberDef PythonEntitySlot_members[] = {
+  {const_cast<char*>("index"), T_PYSSIZET, offsetof(PythonEntitySlot, index), READONLY, nullptr},
+  {const_cast<char*>("name"), T_OBJECT, offsetof(PythonEntitySlot, name), READONLY, nullptr},
+  {nullptr, 0, 0, 0, nullptr}
 };
 
+static PyTypeObject PythonEntitySlot_Type;
+
+// Ready the Slot type and add it to the current module.
+static void export_slot_type() {
+  PyTypeObject &type = PythonEntitySlot_Type;
+  type.tp_name = "_entityx.Slot";
+  type.tp_basicsize = sizeof(PythonEntitySlot);
+  type.tp_flags = Py_TPFLAGS_DEFAULT;
+  type.tp_doc = "Slot(index, name): stores an entity attribute in slot index of the C++ entity.";
+  type.tp_new = PythonEntitySlot_new;
+  type.tp_dealloc = PythonEntitySlot_dealloc;
+  type.tp_descr_get = PythonEntitySlot_get;
+  type.tp_descr_set = PythonEntitySlot_set;
+  type.tp_members = PythonEntitySlot_members;
+  // The type is static, so it must never be deallocated.
+  Py_INCREF(&type);
+  if ( PyType_Ready(&type) < 0 ) {
+    py::throw_error_already_set();
+  }
+  py::scope().attr("Slot") = py::object(py::handle<>(py::borrowed(reinterpret_cast<PyObject*>(&type))));
+}
+
 static std::string PythonEntity_repr(const PythonEntity &entity) {
   std::stringstream repr;
   repr << "<Entity " << entity._entity.id().index() << "." << entity._entity.id().version() << ">";
@@ -96,17 +259,395 @@ struct EntityToPythonEntity {
   }
 };
 
+/**
+ * Iterates over (entity, component...) rows of the entities that have a set
+ * of components.
+ *
+ * Matching entities are collected up front, and each row is re-checked when
+ * it is reached, so entities and components may be removed while iterating.
+ * The row tuple is reused if the caller has released it. Iterating once the
+ * PythonSystem of the world has been destroyed raises RuntimeError.
+ */
+class PythonEntityQuery {
+public:
+  PythonEntityQuery(PythonSystem &system, const std::vector<const ComponentAccessor*> &accessors)
+    : entity_manager_(system.em_), alive_(system.alive_), accessors_(accessors), next_(0) {
+    accessors_[0]->collect(entity_manager_, ids_);
+  }
+
+  // Query the world of the PythonSystem that owns entity_manager.
+  static PythonEntityQuery *create(EntityManager &entity_manager, py::tuple components);
+
+  py::object next() {
+    if ( alive_.expired() ) {
+      PyErr_SetString(PyExc_RuntimeError, "the world of this entities_with() iterator has been destroyed");
+      py::throw_error_already_set();
+    }
+    while ( next_ < ids_.size() ) {
+      Entity::Id id = ids_[next_++];
+      if ( matches(id) ) {
+        return row(id);
+      }
+    }
+    PyErr_SetNone(PyExc_StopIteration);
+    py::throw_error_already_set();
+    return py::object();
+  }
+
+private:
+  bool matches(Entity::Id id) const {
+    if ( !entity_manager_.valid(id) ) {
+      return false;
+    }
+    for ( auto accessor : accessors_ ) {
+      if ( !accessor->has(entity_manager_, id) ) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  py::object row(Entity::Id id) {
+    const Py_ssize_t size = accessors_.size() + 1;
+    if ( !row_ || Py_REFCNT(row_.get()) > 1 ) {
+      row_ = py::handle<>(PyTuple_New(size));
+    } else {
+      for ( Py_ssize_t i = 0; i < size; ++i ) {
+        Py_CLEAR(PyTuple_GET_ITEM(row_.get(), i));
+      }
+    }
+    PyTuple_SET_ITEM(row_.get(), 0, py::incref(entity(id).ptr()));
+    for ( Py_ssize_t i = 1; i < size; ++i ) {
+      PyTuple_SET_ITEM(row_.get(), i, py::incref(accessors_[i - 1]->get(entity_manager_, id).ptr()));
+    }
+    return py::object(row_);
+  }
+
+  // The Python entity for scripted entities, otherwise the EntityId.
+  py::object entity(Entity::Id id) {
+    auto script = entity_manager_.component<PythonScript>(id);
+    if ( script && script->object ) {
+      return script->object;
+    }
+    return py::object(id);
+  }
+
+  EntityManager &entity_manager_;
+  std::weak_ptr<void> alive_;
+  std::vector<const ComponentAccessor*> accessors_;
+  std::vector<Entity::Id> ids_;
+  size_t next_;
+  py::handle<> row_;
+};
+
+static std::unordered_map<PyObject*, ComponentAccessor> &component_accessors() {
+  static std::unordered_map<PyObject*, ComponentAccessor> accessors;
+  return accessors;
+}
+
+const ComponentAccessor *ComponentAccessor::find(PyObject *cls) {
+  auto it = component_accessors().find(cls);
+  return it == component_accessors().end() ? nullptr : &it->second;
+}
+
+void ComponentAccessor::add(PyTypeObject *cls, const ComponentAccessor &accessor) {
+  component_accessors()[reinterpret_cast<PyObject*>(cls)] = accessor;
+}
+
+PythonEntityQuery *PythonEntityQuery::create(EntityManager &entity_manager, py::tuple components) {
+  PythonSystem *system = PythonSystem::active_;
+  if ( !system || &system->em_ != &entity_manager ) {
+    auto it = std::find_if(PythonSystem::systems_.begin(), PythonSystem::systems_.end(),
+                           [&](PythonSystem *system) { return &system->em_ == &entity_manager; });
+    if ( it == PythonSystem::systems_.end() ) {
+      PyErr_SetString(PyExc_RuntimeError, "the EntityManager does not belong to a PythonSystem");
+      py::throw_error_already_set();
+    }
+    system = *it;
+  }
+  std::vector<const ComponentAccessor*> accessors;
+  for ( py::ssize_t i = 0; i < py::len(components); ++i ) {
+    py::object cls = components[i];
+    const ComponentAccessor *accessor = ComponentAccessor::find(cls.ptr());
+    if ( !accessor ) {
+      PyErr_Format(PyExc_TypeError, "%s is not a registered component",
+                   py::extract<std::string>(py::str(cls))().c_str());
+      py::throw_error_already_set();
+    }
+    accessors.push_back(accessor);
+  }
+  if ( accessors.empty() ) {
+    PyErr_SetString(PyExc_TypeError, "entities_with() requires at least one component");
+    py::throw_error_already_set();
+  }
+  return new PythonEntityQuery(*system, accessors);
+}
+
+// Type-erased operations on one PythonComponent<N> family.
+struct PythonComponentFamily {
+  void (*assign)(EntityManager &, Entity::Id, const py::object &);
+  void (*remove)(EntityManager &, Entity::Id);
+  py::object (*get)(EntityManager &, Entity::Id);
+  void (*each)(EntityManager &, const std::function<void(Entity, const py::object &)> &);
+  ComponentAccessor accessor;
+};
+
+template <size_t N>
+static void PythonComponent_assign(EntityManager &entity_manager, Entity::Id id, const py::object &component) {
+  if ( CommandBuffer *commands = CommandBuffer::recording_for(entity_manager) ) {
+    commands->assign<PythonComponent<N>>(id, component);
+    return;
+  }
+  entity_manager.assign<PythonComponent<N>>(id, component);
+}
+
+template <size_t N>
+static py::object PythonComponent_get(EntityManager &entity_manager, Entity::Id id) {
+  auto component = entity_manager.component<PythonComponent<N>>(id);
+  return component ? component->object : None;
+}
+
+template <size_t N>
+static void PythonComponent_each(EntityManager &entity_manager,
+                                 const std::function<void(Entity, const py::object &)> &f) {
+  for ( Entity entity : entity_manager.entities_with_components<PythonComponent<N>>() ) {
+    f(entity, entity.component<PythonComponent<N>>()->object);
+  }
+}
+
+template <size_t ...N>
+static std::vector<PythonComponentFamily> python_component_families(detail::indices<N...>) {
+  return {
+    PythonComponentFamily{
+      &PythonComponent_assign<N>, &remove_from<PythonComponent<N>>, &PythonComponent_get<N>, &PythonComponent_each<N>,
+      ComponentAccessor::of<PythonComponent<N>>(&PythonComponent_get<N>)
+    }...
+  };
+}
+
+static const std::vector<PythonComponentFamily> &python_component_families() {
+  static const std::vector<PythonComponentFamily> families = python_component_families(
+    detail::make_indices<ENTITYX_PYTHON_COMPONENT_FAMILIES>::type());
+  return families;
+}
+
+// Python component classes, and the index of the family bound to each.
+static std::vector<py::object> python_component_classes;
+static std::unordered_map<PyObject*, size_t> python_component_indices;
+
+static const PythonComponentFamily *python_component_family(const py::object &cls) {
+  auto it = python_component_indices.find(cls.ptr());
+  return it == python_component_indices.end() ? nullptr : &python_component_families()[it->second];
+}
+
+static const PythonComponentFamily &python_component_family_or_raise(const py::object &cls) {
+  const PythonComponentFamily *family = python_component_family(cls);
+  if ( !family ) {
+    PyErr_Format(PyExc_TypeError, "%s is not a subclass of entityx.PythonComponent",
+                 py::extract<std::string>(py::str(cls))().c_str());
+    py::throw_error_already_set();
+  }
+  return *family;
+}
+
+static std::string python_class_name(const py::object &cls) {
+  return py::extract<std::string>(py::str(cls.attr("__module__")))() + "." +
+         py::extract<std::string>(py::str(cls.attr("__name__")))();
+}
+
+// Classes replaced by reloading their module. They keep their family, for
+// components that have not been switched to the new class.
+static std::vector<py::object> replaced_python_component_classes;
+// While PythonSystem::reload() re-executes a module, its Python component
+// classes by qualified name.
+static std::unordered_map<std::string, py::object> *reloading_python_component_classes = nullptr;
+
+void register_python_component(py::object cls) {
+  if ( python_component_family(cls) ) {
+    return;
+  }
+  // A class redefined by reloading its module takes over the family of the
+  // class it replaces, so that existing components are still found.
+  if ( reloading_python_component_classes ) {
+    auto replaced = reloading_python_component_classes->find(python_class_name(cls));
+    if ( replaced != reloading_python_component_classes->end() ) {
+      const size_t index = python_component_indices[replaced->second.ptr()];
+      replaced_python_component_classes.push_back(replaced->second);
+      reloading_python_component_classes->erase(replaced);
+      python_component_classes[index] = cls;
+      python_component_indices[cls.ptr()] = index;
+      ComponentAccessor::add(reinterpret_cast<PyTypeObject*>(cls.ptr()), python_component_families()[index].accessor);
+      return;
+    }
+  }
+  const size_t index = python_component_classes.size();
+  if ( index == python_component_families().size() ) {
+    PyErr_Format(PyExc_RuntimeError, "more than %d PythonComponent classes; increase ENTITYX_PYTHON_COMPONENT_FAMILIES",
+                 ENTITYX_PYTHON_COMPONENT_FAMILIES);
+    py::throw_error_already_set();
+  }
+  python_component_classes.push_back(cls);
+  python_component_indices[cls.ptr()] = index;
+  ComponentAccessor::add(reinterpret_cast<PyTypeObject*>(cls.ptr()), python_component_families()[index].accessor);
+}
+
+void PythonComponent_assign_to(py::object component, EntityManager &entity_manager, Entity::Id id) {
+  python_component_family_or_raise(py::object(component.attr("__class__"))).assign(entity_manager, id, component);
+}
+
+void PythonComponent_remove_from(py::object cls, EntityManager &entity_manager, Entity::Id id) {
+  python_component_family_or_raise(cls).remove(entity_manager, id);
+}
+
+py::object python_component(EntityManager &entity_manager, Entity::Id id, const py::object &cls) {
+  const PythonComponentFamily *family = python_component_family(cls);
+  return family ? family->get(entity_manager, id) : None;
+}
+
+py::object PythonComponent_get_component(py::object cls, EntityManager &entity_manager, Entity::Id id) {
+  return python_component(entity_manager, id, cls);
+}
+
+void each_python_component(EntityManager &entity_manager, const py::object &cls,
+                           const std::function<void(Entity, const py::object &)> &f) {
+  if ( const PythonComponentFamily *family = python_component_family(cls) ) {
+    family->each(entity_manager, f);
+  }
+}
+
+static std::vector<detail::ChangedBits*> &changed_bits() {
+  static std::vector<detail::ChangedBits*> bits;
+  return bits;
+}
+
+void detail::add_changed_bits(ChangedBits *bits) {
+  changed_bits().push_back(bits);
+}
+
+void clear_changed_components(const EntityManager &entity_manager) {
+  for ( detail::ChangedBits *bits : changed_bits() ) {
+    if ( bits->entity_manager == &entity_manager ) {
+      std::fill(bits->bits.begin(), bits->bits.end(), 0);
+    }
+  }
+}
+
+// Forget the pool chunks of an EntityManager that is going away.
+static void forget_changed_components(const EntityManager &entity_manager) {
+  for ( detail::ChangedBits *bits : changed_bits() ) {
+    if ( bits->entity_manager == &entity_manager ) {
+      bits->chunks.clear();
+      bits->bits.clear();
+    }
+  }
+}
+
+static std::unordered_map<std::string, Kernel> &kernels() {
+  static std::unordered_map<std::string, Kernel> kernels;
+  return kernels;
+}
+
+void register_kernel(const std::string &name, Kernel kernel) {
+  kernels()[name] = kernel;
+}
+
+bool has_kernel(const std::string &name) {
+  return kernels().count(name) > 0;
+}
+
+void EntityManager_run_kernel(EntityManager& entity_manager, const std::string &name, py::tuple args) {
+  auto it = kernels().find(name);
+  if ( it == kernels().end() ) {
+    PyErr_Format(PyExc_KeyError, "no kernel named '%s'", name.c_str());
+    py::throw_error_already_set();
+  }
+  it->second(entity_manager, args);
+}
+
+void axpy(float *y, const float *x, float a, size_t n) {
+  size_t i = 0;
+#if defined(__AVX__)
+  const __m256 a8 = _mm256_set1_ps(a);
+  for ( ; i + 8 <= n; i += 8 ) {
+    __m256 r = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(a8, _mm256_loadu_ps(x + i)));
+    _mm256_storeu_ps(y + i, r);
+  }
+#endif
+#if defined(__SSE__)
+  const __m128 a4 = _mm_set1_ps(a);
+  for ( ; i + 4 <= n; i += 4 ) {
+    __m128 r = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(a4, _mm_loadu_ps(x + i)));
+    _mm_storeu_ps(y + i, r);
+  }
+#endif
+  for ( ; i < n; ++i ) {
+    y[i] += a * x[i];
+  }
+}
+
+// The PythonScript pool is indexed by entity index, so this is a version
+// check and a lookup.
+py::object EntityManager_get(EntityManager& entity_manager, Entity::Id id) {
+  if ( !entity_manager.valid(id) ) {
+    return None;
+  }
+  auto script = entity_manager.component<PythonScript>(id);
+  return script ? script->object : None;
+}
+
 Entity::Id EntityManager_configure(EntityManager& entity_manager, py::object self) {
   Entity entity = entity_manager.create();
   entity.assign<PythonScript>(self);
   return entity.id();
 }
 
+void InstanceIndex::add(Entity::Id id, const py::object &object) {
+  positions_[id.id()] = objects_.size();
+  objects_.push_back(object);
+  ids_.push_back(id);
+}
+
+void InstanceIndex::remove(Entity::Id id) {
+  auto it = positions_.find(id.id());
+  if ( it == positions_.end() ) {
+    return;
+  }
+  const size_t position = it->second;
+  positions_.erase(it);
+  if ( position != objects_.size() - 1 ) {
+    objects_[position] = objects_.back();
+    ids_[position] = ids_.back();
+    positions_[ids_[position].id()] = position;
+  }
+  objects_.pop_back();
+  ids_.pop_back();
+}
+
+static py::object InstanceIndex_getitem(const InstanceIndex &index, py::ssize_t i) {
+  if ( i < 0 ) {
+    i += index.size();
+  }
+  if ( i < 0 || static_cast<size_t>(i) >= index.size() ) {
+    PyErr_SetString(PyExc_IndexError, "instance index out of range");
+    py::throw_error_already_set();
+  }
+  return index[i];
+}
+
+py::list PythonSystem_clone(PythonSystem& python, Entity prototype, size_t n) {
+  py::list clones;
+  for ( Entity clone : python.clone(prototype, n) ) {
+    clones.append(clone);
+  }
+  return clones;
+}
+
 BOOST_PYTHON_MODULE(_entityx) {
   py::to_python_converter<Entity, EntityToPythonEntity>();
 
   py::class_<PythonEntityXLogger>("Logger", py::no_init)
-    .def("write", &PythonEntityXLogger::write);
+    .def("write", &PythonEntityXLogger::write)
+    .def("flush", &PythonEntityXLogger::flush);
 
   py::class_<BaseEvent, boost::noncopyable>("BaseEvent", py::no_init);
 
@@ -114,8 +655,12 @@ BOOST_PYTHON_MODULE(_entityx) {
     .def_readonly("_entity_id", &PythonEntity::_entity_id)
     .def("update", &PythonEntity::update)
     .def("destroy", &PythonEntity::destroy)
+    .def("_rebind", &PythonEntity::_rebind)
+    .def("_copy_state", &PythonEntity_copy_state)
     .def("__repr__", &PythonEntity_repr);
 
+  export_slot_type();
+
   py::class_<Entity::Id>("EntityId", py::no_init)
     .def_readonly("id", &Entity::Id::id)
     .def_readonly("index", &Entity::Id::index)
@@ -129,7 +674,36 @@ BOOST_PYTHON_MODULE(_entityx) {
     .staticmethod("get_component");
 
   py::class_<EntityManager, boost::noncopyable>("EntityManager", py::no_init)
-    .def("configure", &EntityManager_configure);
+    .def("configure", &EntityManager_configure)
+    .def("get", &EntityManager_get)
+    .def("entities_with", &PythonEntityQuery::create,
+         py::return_value_policy<py::manage_new_object>())
+    .def("run_kernel", &EntityManager_run_kernel);
+
+  py::def("has_kernel", &has_kernel);
+
+  py::def("_register_python_component", &register_python_component);
+  py::def("_python_component_assign_to", &PythonComponent_assign_to);
+  py::def("_python_component_remove_from", &PythonComponent_remove_from);
+  py::def("_python_component_get_component", &PythonComponent_get_component);
+
+  py::class_<PythonEntityQuery, boost::noncopyable>("EntityQuery", py::no_init)
+    .def("__iter__", py::objects::identity_function())
+    .def("next", &PythonEntityQuery::next)
+    .def("__next__", &PythonEntityQuery::next);
+
+  py::class_<CommandBuffer, boost::noncopyable>("CommandBuffer", py::no_init)
+    .def("suspend", &CommandBuffer::suspend)
+    .def("resume", &CommandBuffer::resume)
+    .def("__len__", &CommandBuffer::size);
+
+  py::class_<PythonSystem, boost::noncopyable>("PythonSystem", py::no_init)
+    .def("clone", &PythonSystem_clone)
+    .def("instances", &PythonSystem::instances);
+
+  py::class_<InstanceIndex, std::shared_ptr<InstanceIndex>, boost::noncopyable>("InstanceIndex", py::no_init)
+    .def("__len__", &InstanceIndex::size)
+    .def("__getitem__", &InstanceIndex_getitem);
 
   void (EventManager::*emit)(const BaseEvent &) = &EventManager::emit;
 
@@ -137,6 +711,35 @@ BOOST_PYTHON_MODULE(_entityx) {
     .def("emit", emit);
 
   py::implicitly_convertible<PythonEntity, Entity>();
+
+  // The entityx.jobs pool, once started.
+  py::scope().attr("_jobs") = None;
+  // The key of the current world, set by PythonSystem::activate().
+  py::scope().attr("_world") = None;
+}
+
+// Command buffers of PythonSystems with deferred mutations enabled.
+static std::vector<std::pair<const EntityManager*, CommandBuffer*>> command_buffers;
+
+CommandBuffer *CommandBuffer::recording_for(const EntityManager &entity_manager) {
+  for ( auto &buffer : command_buffers ) {
+    if ( buffer.first == &entity_manager ) {
+      return buffer.second->suspended() ? nullptr : buffer.second;
+    }
+  }
+  return nullptr;
+}
+
+void CommandBuffer::apply(EntityManager &entity_manager) {
+  while ( !commands_.empty() ) {
+    std::vector<Command> commands;
+    commands.swap(commands_);
+    for ( const Command &command : commands ) {
+      if ( entity_manager.valid(command.id) ) {
+        command.apply(entity_manager, command.id, command.component);
+      }
+    }
+  }
 }
 
 static void log_to_stderr(const std::string &text) {
@@ -147,30 +750,263 @@ static void log_to_stdout(const std::string &text) {
   std::cout << "python stdout: " << text << std::endl;
 }
 
+#ifdef ENTITYX_PYTHON_FREEZE_PACKAGE
+namespace detail {
+extern const FrozenModule frozen_modules[];
+}  // namespace detail
+
+// Add the entityx package compiled into the library to the interpreter's
+// frozen modules, so that importing it does not touch the filesystem.
+static void freeze_entityx_package() {
+  static std::vector<struct _frozen> table;
+  for ( const detail::FrozenModule *module = detail::frozen_modules; module->name; ++module ) {
+#if PY_VERSION_HEX >= 0x030B0000
+    table.push_back({module->name, module->code, module->size, module->is_package, nullptr});
+#elif PY_MAJOR_VERSION >= 3
+    table.push_back({module->name, module->code, module->is_package ? -module->size : module->size});
+#else
+    // Python 2 marks packages with a negative size.
+    table.push_back({const_cast<char*>(module->name), const_cast<unsigned char*>(module->code),
+                     module->is_package ? -module->size : module->size});
+#endif
+  }
+  for ( const struct _frozen *module = PyImport_FrozenModules; module && module->name; ++module ) {
+    table.push_back(*module);
+  }
+  table.push_back(_frozen());
+  PyImport_FrozenModules = table.data();
+}
+#endif
+
+namespace detail {
+// Timings of PythonSystem startup, as a tree of phases and imports stored in
+// pre-order.
+class StartupProfile {
+public:
+  explicit StartupProfile(const std::string &json_path) : json_path(json_path), depth_(0) {}
+
+  size_t begin(const std::string &name) {
+    entries_.push_back(Entry{name, depth_++, std::chrono::steady_clock::now(), 0.0});
+    return entries_.size() - 1;
+  }
+
+  void end(size_t entry) {
+    --depth_;
+    entries_[entry].seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - entries_[entry].start).count();
+  }
+
+  // End an entry that is not worth reporting, dropping it if it has no
+  // children.
+  void discard(size_t entry) {
+    end(entry);
+    if ( entry + 1 == entries_.size() ) {
+      entries_.pop_back();
+    }
+  }
+
+  std::vector<std::string> lines() const {
+    std::vector<std::string> lines;
+    for ( const Entry &entry : entries_ ) {
+      std::ostringstream line;
+      line << std::fixed << std::setprecision(3) << std::setw(10) << entry.seconds * 1000.0 << " ms  "
+           << std::string(2 * entry.depth, ' ') << entry.name;
+      lines.push_back(line.str());
+    }
+    return lines;
+  }
+
+  // A list of {"name", "ms", "children"} objects.
+  std::string json() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << "[";
+    int open = 0;
+    bool first = true;
+    for ( const Entry &entry : entries_ ) {
+      for ( ; open > entry.depth; --open ) {
+        out << "]}";
+        first = false;
+      }
+      if ( !first ) {
+        out << ", ";
+      }
+      out << "{\"name\": \"" << escape(entry.name) << "\", \"ms\": " << entry.seconds * 1000.0
+          << ", \"children\": [";
+      ++open;
+      first = true;
+    }
+    for ( ; open > 0; --open ) {
+      out << "]}";
+    }
+    out << "]";
+    return out.str();
+  }
+
+  const std::string json_path;
+
+private:
+  struct Entry {
+    std::string name;
+    int depth;
+    std::chrono::steady_clock::time_point start;
+    double seconds;
+  };
+
+  static std::string escape(const std::string &text) {
+    std::ostringstream out;
+    for ( unsigned char c : text ) {
+      if ( c == '"' || c == '\\' ) {
+        out << '\\' << c;
+      } else if ( c < 0x20 ) {
+        out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+      } else {
+        out << c;
+      }
+    }
+    return out.str();
+  }
+
+  std::vector<Entry> entries_;
+  int depth_;
+};
+
+// Times a startup phase, if profiling.
+class ProfileScope {
+public:
+  ProfileScope(StartupProfile *profile, const std::string &name)
+    : profile_(profile), entry_(profile ? profile->begin(name) : 0) {}
+
+  ~ProfileScope() {
+    if ( profile_ ) {
+      profile_->end(entry_);
+    }
+  }
+
+private:
+  StartupProfile *profile_;
+  size_t entry_;
+};
+}  // namespace detail
+
+// Used by the next PythonSystem constructed.
+static std::unique_ptr<detail::StartupProfile> pending_startup_profile;
+// The profile that __import__ records to, and the __import__ it replaced.
+static detail::StartupProfile *import_profile = nullptr;
+static py::object original_import;
+
+static py::object builtins_module() {
+#if PY_MAJOR_VERSION >= 3
+  return py::import("builtins");
+#else
+  return py::import("__builtin__");
+#endif
+}
+
+// Replaces __import__, recording the imports that load a module.
+static py::object profiled_import(py::tuple args, py::dict kwargs) {
+  detail::StartupProfile *profile = import_profile;
+  const std::string name = py::extract<std::string>(py::str(args[0]));
+  const Py_ssize_t loaded = PyDict_Size(PyImport_GetModuleDict());
+  const size_t entry = profile->begin(name);
+  PyObject *module = PyObject_Call(original_import.ptr(), args.ptr(), kwargs.ptr());
+  if ( PyDict_Size(PyImport_GetModuleDict()) > loaded ) {
+    profile->end(entry);
+  } else {
+    profile->discard(entry);
+  }
+  return py::object(py::handle<>(module));
+}
+
+static void hook_imports(detail::StartupProfile *profile) {
+  if ( import_profile ) {
+    return;
+  }
+  py::object builtins = builtins_module();
+  original_import = builtins.attr("__import__");
+  builtins.attr("__import__") = py::raw_function(profiled_import, 1);
+  import_profile = profile;
+}
+
+static void unhook_imports() {
+  builtins_module().attr("__import__") = original_import;
+  original_import = py::object();
+  import_profile = nullptr;
+}
+
 // PythonSystem below here
 
 bool PythonSystem::initialized_ = false;
+std::vector<PythonSystem*> PythonSystem::systems_;
+// sys.modules and sys.path after the interpreter was initialized, restored by
+// reset_interpreter().
+static py::object initial_modules, initial_path;
+PythonSystem *PythonSystem::active_ = nullptr;
+// The number of PythonSystems created, to give each world a distinct key.
+static size_t world_count = 0;
+
+PythonWorldScope::PythonWorldScope(PythonSystem *system) : previous_(PythonSystem::active_) {
+  if ( system && system != previous_ ) {
+    system->activate();
+  }
+}
+
+PythonWorldScope::~PythonWorldScope() {
+  if ( previous_ && previous_ != PythonSystem::active_ ) {
+    previous_->activate();
+  }
+}
 
 PythonSystem::PythonSystem(EntityManager& entity_manager)
-  : em_(entity_manager), stdout_(log_to_stdout), stderr_(log_to_stderr) {
+  : em_(entity_manager), event_manager_(nullptr), stdout_(log_to_stdout), stderr_(log_to_stderr),
+    preload_budget_(0.005), defer_mutations_(false), startup_profile_(std::move(pending_startup_profile)),
+    alive_(std::make_shared<bool>(true)), world_(++world_count) {
   if ( !initialized_ ) {
     initialize_python_module();
   }
-  Py_Initialize();
+  {
+    detail::ProfileScope profile(startup_profile_.get(), "Py_Initialize");
+    Py_Initialize();
+  }
   if ( !initialized_ ) {
+    detail::ProfileScope profile(startup_profile_.get(), "init_entityx");
     init_entityx();
     initialized_ = true;
+    py::object sys = py::import("sys");
+    initial_modules = sys.attr("modules").attr("copy")();
+    initial_path = py::list(sys.attr("path"));
+  }
+  systems_.push_back(this);
+  if ( startup_profile_ ) {
+    hook_imports(startup_profile_.get());
   }
 }
 
 PythonSystem::~PythonSystem() {
+  systems_.erase(std::find(systems_.begin(), systems_.end(), this));
+  unregister_command_buffer();
+  forget_changed_components(em_);
   try {
-    py::object entityx = py::import("_entityx");
-    entityx.attr("_entity_manager").del();
-    entityx.attr("_event_manager").del();
-    py::object sys = py::import("sys");
-    sys.attr("stdout").del();
-    sys.attr("stderr").del();
+    if ( startup_profile_ && import_profile == startup_profile_.get() ) {
+      unhook_imports();
+    }
+    // Other worlds make themselves current again when next entered.
+    if ( active_ == this ) {
+      active_ = nullptr;
+      py::object entityx = py::import("_entityx");
+      entityx.attr("_entity_manager").del();
+      entityx.attr("_event_manager").del();
+      entityx.attr("_python_system").del();
+      entityx.attr("_commands").del();
+      entityx.attr("_world") = None;
+      py::object sys = py::import("sys");
+      sys.attr("stdout").del();
+      sys.attr("stderr").del();
+    }
+    // Jobs submitted from this world are never resolved.
+    py::object jobs = py::import("_entityx").attr("_jobs");
+    if ( !jobs.is_none() ) {
+      jobs.attr("discard")(world_);
+    }
     py::object gc = py::import("gc");
     gc.attr("collect")();
   }
@@ -179,9 +1015,89 @@ PythonSystem::~PythonSystem() {
     PyErr_Clear();
     throw;
   }
-  // FIXME: It would be good to do this, but it is not supported by boost::python:
+  // Py_Finalize() is not supported by boost::python, see
   // http://www.boost.org/doc/libs/1_53_0/libs/python/todo.html#pyfinalize-safety
-  // Py_Finalize();
+  // Script state is reclaimed by reset_interpreter() instead.
+}
+
+void PythonSystem::profile_startup(const std::string &json_path) {
+  pending_startup_profile.reset(new detail::StartupProfile(json_path));
+}
+
+static bool is_builtin_module(const std::string &name) {
+  for ( const struct _inittab *module = PyImport_Inittab; module->name; ++module ) {
+    if ( name == module->name ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PythonSystem::reset_interpreter() {
+  assert(systems_.empty() && "reset_interpreter() called while a PythonSystem exists");
+  if ( !initialized_ ) {
+    return;
+  }
+  try {
+    py::object entityx = py::import("_entityx");
+    py::object jobs = entityx.attr("_jobs");
+    if ( !jobs.is_none() ) {
+      jobs.attr("close")();
+      entityx.attr("_jobs") = None;
+    }
+
+    // Python component classes belong to the modules being dropped.
+    for ( const py::object &cls : python_component_classes ) {
+      component_accessors().erase(cls.ptr());
+    }
+    for ( const py::object &cls : replaced_python_component_classes ) {
+      component_accessors().erase(cls.ptr());
+    }
+    python_component_classes.clear();
+    replaced_python_component_classes.clear();
+    python_component_indices.clear();
+
+    py::object sys = py::import("sys");
+    py::dict modules = py::extract<py::dict>(sys.attr("modules"));
+    py::list names = modules.keys();
+    for ( py::ssize_t i = 0; i < py::len(names); ++i ) {
+      py::object name = names[i];
+      if ( !initial_modules.contains(name) && !is_builtin_module(py::extract<std::string>(name)) ) {
+        modules[name].del();
+      }
+    }
+    sys.attr("path") = py::list(initial_path);
+    sys.attr("path_importer_cache").attr("clear")();
+    py::import("linecache").attr("clearcache")();
+    py::import("gc").attr("collect")();
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    throw;
+  }
+}
+
+void PythonSystem::finish_startup_profile() {
+  if ( !startup_profile_ ) {
+    return;
+  }
+  if ( import_profile == startup_profile_.get() ) {
+    unhook_imports();
+  }
+  if ( startup_profile_->json_path.empty() ) {
+    stdout_("Startup profile:");
+    for ( const std::string &line : startup_profile_->lines() ) {
+      stdout_(line);
+    }
+  } else {
+    std::ofstream out(startup_profile_->json_path);
+    out << startup_profile_->json() << std::endl;
+    if ( !out ) {
+      stderr_("Failed to write startup profile to " + startup_profile_->json_path);
+    }
+  }
+  startup_profile_.reset();
 }
 
 void PythonSystem::add_installed_library_path() {
@@ -192,14 +1108,22 @@ void PythonSystem::add_path(const std::string &path) {
   python_paths_.push_back(path);
 }
 
+void PythonSystem::add_bundle(const std::string &path) {
+  bundles_.push_back(path);
+}
+
 void PythonSystem::initialize_python_module() {
   assert(PyImport_AppendInittab("_entityx", init_entityx) != -1 &&
          "Failed to initialize _entityx Python module");
+#ifdef ENTITYX_PYTHON_FREEZE_PACKAGE
+  freeze_entityx_package();
+#endif
 }
 
 void PythonSystem::configure(EventManager& ev) {
   ev.subscribe<EntityDestroyedEvent>(*this);
   ev.subscribe<ComponentAddedEvent<PythonScript>>(*this);
+  detail::ProfileScope profile(startup_profile_.get(), "configure");
 
   try {
     py::object main_module = py::import("__main__");
@@ -207,18 +1131,22 @@ void PythonSystem::configure(EventManager& ev) {
 
     // Initialize logging.
     py::object sys = py::import("sys");
-    sys.attr("stdout") = PythonEntityXLogger(stdout_);
-    sys.attr("stderr") = PythonEntityXLogger(stderr_);
+    stdout_logger_ = py::object(PythonEntityXLogger(stdout_));
+    stderr_logger_ = py::object(PythonEntityXLogger(stderr_));
 
     // Add paths to interpreter sys.path
     for ( auto path : python_paths_ ) {
+      detail::ProfileScope insert_profile(startup_profile_.get(), "sys.path: " + path);
       py::str dir = path.c_str();
       sys.attr("path").attr("insert")(0, dir);
     }
+    for ( auto path : bundles_ ) {
+      detail::ProfileScope insert_profile(startup_profile_.get(), "sys.path: " + path);
+      sys.attr("path").attr("insert")(0, py::str(path.c_str()));
+    }
 
-    py::object entityx = py::import("_entityx");
-    entityx.attr("_entity_manager") = boost::ref<EntityManager>(em_);
-    entityx.attr("_event_manager") = boost::ref<EventManager>(ev);
+    event_manager_ = &ev;
+    activate();
   }
   catch ( ... ) {
     PyErr_Print();
@@ -227,8 +1155,63 @@ void PythonSystem::configure(EventManager& ev) {
   }
 }
 
+void PythonSystem::activate() {
+  py::object sys = py::import("sys");
+  sys.attr("stdout") = stdout_logger_;
+  sys.attr("stderr") = stderr_logger_;
+
+  py::object entityx = py::import("_entityx");
+  entityx.attr("_entity_manager") = boost::ref<EntityManager>(em_);
+  if ( event_manager_ ) {
+    entityx.attr("_event_manager") = boost::ref<EventManager>(*event_manager_);
+  } else {
+    entityx.attr("_event_manager") = None;
+  }
+  entityx.attr("_python_system") = boost::ref<PythonSystem>(*this);
+  entityx.attr("_world") = world_;
+  if ( defer_mutations_ ) {
+    entityx.attr("_commands") = boost::ref<CommandBuffer>(commands_);
+  } else {
+    entityx.attr("_commands") = None;
+  }
+  active_ = this;
+}
+
 void PythonSystem::update(EntityManager & em,
                           EventManager & events, TimeDelta dt) {
+  PythonWorldScope scope(this);
+
+  // Changes from the previous frame have been seen by native systems.
+  clear_changed_components(em);
+
+  import_preloads();
+
+  // Entities queued with spawn(), possibly from other threads.
+  try {
+    spawn_queue_.consume(em);
+  }
+  catch ( const py::error_already_set& ) {
+    PyErr_Print();
+    PyErr_Clear();
+    throw;
+  }
+
+  // Entities copied with EntityManager::create_from_copy() directly.
+  finish_clones();
+
+  // Results of entityx.submit() jobs from this world that have finished.
+  try {
+    py::object jobs = py::import("_entityx").attr("_jobs");
+    if ( !jobs.is_none() ) {
+      jobs.attr("resolve")(world_);
+    }
+  }
+  catch ( const py::error_already_set& ) {
+    PyErr_Print();
+    PyErr_Clear();
+    throw;
+  }
+
   em.each<PythonScript>(
     [=](Entity entity, PythonScript& python) {
     try {
@@ -241,6 +1224,259 @@ void PythonSystem::update(EntityManager & em,
       throw;
     }
   });
+
+  update_batch_systems(dt);
+
+  apply_commands();
+
+  finish_startup_profile();
+}
+
+void PythonSystem::import_preloads() {
+  const auto start = std::chrono::steady_clock::now();
+  while ( !preload_.empty() ) {
+    const std::string module = preload_.front();
+    preload_.pop_front();
+    try {
+      cache_script_classes(module, py::import(module.c_str()));
+    }
+    catch ( const py::error_already_set& ) {
+      PyErr_Print();
+      PyErr_Clear();
+    }
+    if ( std::chrono::steady_clock::now() - start >= preload_budget_ ) {
+      break;
+    }
+  }
+}
+
+void PythonSystem::cache_script_classes(const std::string &module_name, py::object module) {
+  py::object entity_base = py::import("_entityx").attr("Entity");
+  py::list items = py::extract<py::dict>(module.attr("__dict__"))().items();
+  for ( py::ssize_t i = 0; i < py::len(items); ++i ) {
+    py::object name = items[i][0], value = items[i][1];
+    if ( !PyType_Check(value.ptr()) || PyObject_IsSubclass(value.ptr(), entity_base.ptr()) != 1 ||
+         py::getattr(value, "__module__", None) != py::str(module_name) ) {
+      continue;
+    }
+    const std::string cls = py::extract<std::string>(name);
+    class_names_[module_name + "." + cls] = &script_class(value);
+  }
+}
+
+void PythonSystem::add_batch_system(const std::string &module, const std::string &cls) {
+  batch_systems_.push_back(BatchSystem{module, cls, py::object()});
+}
+
+// Move the __slots__ values of an entity switched from old_cls to new_cls to
+// the slots of the same names.
+static void remap_slots(const py::object &object, const py::object &old_cls, const py::object &new_cls) {
+  py::extract<PythonEntity&> python_entity(object);
+  if ( !python_entity.check() ) {
+    return;
+  }
+  std::vector<py::handle<>> &old_slots = python_entity()._slots;
+  py::object old_names = old_cls.attr("_slot_names"), new_names = new_cls.attr("_slot_names");
+  std::vector<py::handle<>> slots(py::len(new_names));
+  for ( size_t i = 0; i < slots.size(); ++i ) {
+    for ( size_t j = 0; j < old_slots.size() && j < size_t(py::len(old_names)); ++j ) {
+      if ( old_names[j] == new_names[i] ) {
+        slots[i] = old_slots[j];
+        break;
+      }
+    }
+  }
+  old_slots.swap(slots);
+}
+
+void PythonSystem::reload_modules(const std::vector<std::string> &modules) {
+  PythonWorldScope scope(this);
+  try {
+    // Classes defined by the reloaded modules, and their new versions.
+    ReplacedClasses replaced;
+    py::object sys_modules = py::import("sys").attr("modules");
+    for ( const std::string &name : modules ) {
+      if ( !sys_modules.contains(name) ) {
+        py::import(name.c_str());
+        continue;
+      }
+      py::object module = sys_modules[name];
+      py::list items = py::extract<py::dict>(module.attr("__dict__"))().items();
+      // Python component classes that the new version of the module may
+      // redefine.
+      std::unordered_map<std::string, py::object> component_classes;
+      for ( py::ssize_t i = 0; i < py::len(items); ++i ) {
+        py::object cls = items[i][1];
+        if ( PyType_Check(cls.ptr()) && python_component_family(cls) && py::getattr(cls, "__module__", None) == name ) {
+          component_classes[python_class_name(cls)] = cls;
+        }
+      }
+      reloading_python_component_classes = &component_classes;
+      PyObject *reloaded = PyImport_ReloadModule(module.ptr());
+      reloading_python_component_classes = nullptr;
+      py::object(py::handle<>(reloaded));
+      py::dict globals = py::extract<py::dict>(module.attr("__dict__"));
+      for ( py::ssize_t i = 0; i < py::len(items); ++i ) {
+        py::object cls = items[i][1];
+        if ( !PyType_Check(cls.ptr()) || !(py::getattr(cls, "__module__", None) == name) ) {
+          continue;
+        }
+        py::object replacement = globals.get(items[i][0]);
+        if ( replacement.ptr() != cls.ptr() && PyType_Check(replacement.ptr()) ) {
+          replaced[cls.ptr()] = std::make_pair(cls, replacement);
+        }
+      }
+    }
+    if ( replaced.empty() ) {
+      return;
+    }
+    // Every world may have instances and caches of the old classes.
+    for ( PythonSystem *system : systems_ ) {
+      system->replace_classes(replaced);
+    }
+  }
+  catch ( const py::error_already_set& ) {
+    PyErr_Print();
+    PyErr_Clear();
+    throw;
+  }
+}
+
+void PythonSystem::replace_classes(const ReplacedClasses &replaced) {
+  // Errors are reported by reload_modules().
+  PythonWorldScope scope(this);
+  auto replacement_for = [&](const py::object &object) -> const py::object* {
+    auto it = replaced.find(reinterpret_cast<PyObject*>(Py_TYPE(object.ptr())));
+    return it == replaced.end() ? nullptr : &it->second.second;
+  };
+
+  // Unregister live entities of the old classes.
+  std::vector<std::pair<Entity, py::object>> entities;
+  em_.each<PythonScript>([&](Entity entity, PythonScript &script) {
+    if ( !script.object.is_none() && replacement_for(script.object) ) {
+      entities.push_back(std::make_pair(entity, script.object));
+    }
+  });
+  for ( auto &entity : entities ) {
+    for ( auto proxy : event_proxies_ ) {
+      proxy->delete_receiver(entity.first);
+    }
+    for ( auto &index : script_class(entity.second.attr("__class__")).indexes ) {
+      index->remove(entity.first.id());
+    }
+  }
+
+  // Retire the cached old classes. Their instance indexes, which scripts
+  // may hold, are handed over to the new classes.
+  std::vector<std::pair<py::object, std::vector<py::object>>> pools;
+  for ( auto &classes : replaced ) {
+    const py::object &cls = classes.second.second;
+    auto index = instance_indexes_.find(classes.first);
+    if ( index != instance_indexes_.end() ) {
+      if ( !instance_indexes_.count(cls.ptr()) ) {
+        instance_indexes_[cls.ptr()] = std::make_pair(cls, index->second.second);
+      }
+      instance_indexes_.erase(index);
+    }
+    auto script_class = classes_.find(classes.first);
+    if ( script_class != classes_.end() ) {
+      for ( auto name = class_names_.begin(); name != class_names_.end(); ) {
+        if ( name->second == &script_class->second ) {
+          name = class_names_.erase(name);
+        } else {
+          ++name;
+        }
+      }
+      pools.push_back(std::make_pair(cls, std::move(script_class->second.pool)));
+      classes_.erase(script_class);
+    }
+  }
+
+  // Switch instances to the new classes.
+  auto switch_class = [&](const py::object &object) {
+    if ( const py::object *cls = replacement_for(object) ) {
+      py::object old_cls = object.attr("__class__");
+      py::setattr(object, "__class__", *cls);
+      remap_slots(object, old_cls, *cls);
+    }
+  };
+  for ( auto &pool : pools ) {
+    for ( auto &object : pool.second ) {
+      switch_class(object);
+    }
+    std::vector<py::object> &class_pool = script_class(pool.first).pool;
+    class_pool.insert(class_pool.end(), pool.second.begin(), pool.second.end());
+  }
+  for ( auto &entity : entities ) {
+    switch_class(entity.second);
+    entity.second.attr("_build_components")();
+    script_created(entity.first, entity.second);
+  }
+  for ( BatchSystem &system : batch_systems_ ) {
+    if ( !system.object.is_none() ) {
+      switch_class(system.object);
+    }
+  }
+  for ( auto &classes : replaced ) {
+    each_python_component(em_, classes.second.second, [&](Entity, const py::object &component) {
+      switch_class(component);
+    });
+  }
+}
+
+void PythonSystem::update_batch_systems(TimeDelta dt) {
+  for ( BatchSystem &system : batch_systems_ ) {
+    try {
+      if ( system.object.is_none() ) {
+        system.object = py::import(system.module.c_str()).attr(system.cls.c_str())();
+      }
+      system.object.attr("_update")(dt);
+    }
+    catch ( const py::error_already_set& ) {
+      PyErr_Print();
+      PyErr_Clear();
+      throw;
+    }
+  }
+}
+
+void PythonSystem::defer_mutations(bool defer) {
+  unregister_command_buffer();
+  if ( defer ) {
+    command_buffers.push_back(std::make_pair(&em_, &commands_));
+  }
+  defer_mutations_ = defer;
+  if ( active_ == this ) {
+    py::object entityx = py::import("_entityx");
+    if ( defer ) {
+      entityx.attr("_commands") = boost::ref<CommandBuffer>(commands_);
+    } else {
+      entityx.attr("_commands") = None;
+    }
+  }
+  if ( !defer ) {
+    apply_commands();
+  }
+}
+
+void PythonSystem::apply_commands() {
+  try {
+    commands_.apply(em_);
+  }
+  catch ( const py::error_already_set& ) {
+    PyErr_Print();
+    PyErr_Clear();
+    throw;
+  }
+}
+
+void PythonSystem::unregister_command_buffer() {
+  for ( auto i = command_buffers.begin(); i != command_buffers.end(); ++i ) {
+    if ( i->second == &commands_ ) {
+      command_buffers.erase(i);
+      break;
+    }
+  }
 }
 
 void PythonSystem::log_to(LoggerFunction sout, LoggerFunction serr) {
@@ -252,32 +1488,165 @@ void PythonSystem::receive(const EntityDestroyedEvent &event) {
   for ( auto proxy : event_proxies_ ) {
     proxy->delete_receiver(event.entity);
   }
+
+  Entity entity = event.entity;
+  auto script = entity.component<PythonScript>();
+  if ( !script || !script->object ) {
+    return;
+  }
+  py::object object = script->object;
+  PythonWorldScope scope(this);
+
+  ScriptClass &script_class = this->script_class(object.attr("__class__"));
+  for ( auto &index : script_class.indexes ) {
+    index->remove(entity.id());
+  }
+
+  // Park the instance for reuse if its class is pooled. Like its __dict__,
+  // its slots are kept for reset() and are rebuilt or overwritten on reuse.
+  // The entity is being destroyed by EntityX, so an exception from reset()
+  // is reported rather than propagated, and the instance is not parked.
+  if ( script_class.pool.size() < script_class.pool_size ) {
+    try {
+      object.attr("reset")();
+      script_class.pool.push_back(object);
+      return;
+    }
+    catch ( const py::error_already_set& ) {
+      PyErr_Print();
+      PyErr_Clear();
+    }
+  }
+
+  // Otherwise release slot values so that references between entities do
+  // not outlive them. Components held in slots would dangle after this point
+  // anyway.
+  py::extract<PythonEntity&> python_entity(object);
+  if ( python_entity.check() ) {
+    python_entity()._slots.clear();
+  }
 }
 
 void PythonSystem::receive(const ComponentAddedEvent<PythonScript> &event) {
+  PythonWorldScope scope(this);
+
+  // If the component was copied from another entity, the Python instance is
+  // cloned once the remaining components have been copied too.
+  if ( event.component->object ) {
+    py::extract<const PythonEntity&> prototype(event.component->object);
+    if ( prototype.check() && prototype()._entity.id() != event.entity.id() ) {
+      ComponentHandle<PythonScript> p = event.component;
+      pending_clones_.push_back(std::make_pair(event.entity, p->object));
+      p->object = py::object();
+      return;
+    }
+  }
+
   // If the component was created in C++ it won't have a Python object
-  // associated with it. Create one.
+  // associated with it. Create one, or reuse a pooled instance.
   if ( !event.component->object ) {
-    py::object module = py::import(event.component->module.c_str());
-    py::object cls = module.attr(event.component->cls.c_str());
-    py::object from_raw_entity = cls.attr("_from_raw_entity");
-    if ( py::len(event.component->args) == 0 ) {
-      ComponentHandle<PythonScript> p = event.component;
-      p->object = from_raw_entity(event.entity.id());
-    } else {
+    ScriptClass &script_class = this->script_class(event.component->module, event.component->cls);
+    ComponentHandle<PythonScript> p = event.component;
+    if ( !script_class.pool.empty() ) {
+      py::object object = script_class.pool.back();
+      script_class.pool.pop_back();
       py::list args;
       args.append(event.entity.id());
       args.extend(event.component->args);
-      ComponentHandle<PythonScript> p = event.component;
-      p->object = from_raw_entity(*py::tuple(args));
+      object.attr("_reuse")(*py::tuple(args));
+      p->object = object;
+    } else {
+      py::object from_raw_entity = script_class.cls.attr("_from_raw_entity");
+      if ( py::len(event.component->args) == 0 ) {
+        p->object = from_raw_entity(event.entity.id());
+      } else {
+        py::list args;
+        args.append(event.entity.id());
+        args.extend(event.component->args);
+        p->object = from_raw_entity(*py::tuple(args));
+      }
     }
   }
 
+  script_created(event.entity, event.component->object);
+}
+
+void PythonSystem::script_created(Entity entity, const py::object &object) {
   for ( auto proxy : event_proxies_ ) {
-    if ( proxy->can_send(event.component->object) ) {
-      proxy->add_receiver(event.entity);
+    if ( proxy->can_send(object) ) {
+      proxy->add_receiver(entity);
+    }
+  }
+  for ( auto &index : script_class(object.attr("__class__")).indexes ) {
+    index->add(entity.id(), object);
+  }
+}
+
+std::shared_ptr<InstanceIndex> PythonSystem::instances(const py::object &cls) {
+  auto &index = instance_indexes_[cls.ptr()];
+  if ( !index.second ) {
+    index = std::make_pair(cls, std::make_shared<InstanceIndex>());
+  }
+  return index.second;
+}
+
+std::vector<Entity> PythonSystem::clone(Entity prototype, size_t n) {
+  PythonWorldScope scope(this);
+  std::vector<Entity> clones;
+  clones.reserve(n);
+  for ( size_t i = 0; i < n; ++i ) {
+    clones.push_back(em_.create_from_copy(prototype));
+  }
+  finish_clones();
+  return clones;
+}
+
+void PythonSystem::finish_clones() {
+  for ( auto &pending : pending_clones_ ) {
+    // The copy may have been destroyed, or its script removed, since.
+    Entity entity = pending.first;
+    if ( !entity.valid() ) {
+      continue;
+    }
+    auto script = entity.component<PythonScript>();
+    if ( !script ) {
+      continue;
+    }
+    script->object = pending.second.attr("_clone")(entity.id());
+    script_created(entity, script->object);
+  }
+  pending_clones_.clear();
+}
+
+PythonSystem::ScriptClass &PythonSystem::script_class(const std::string &module, const std::string &cls) {
+  const std::string name = module + "." + cls;
+  auto it = class_names_.find(name);
+  if ( it != class_names_.end() ) {
+    return *it->second;
+  }
+  ScriptClass &script_class = this->script_class(py::import(module.c_str()).attr(cls.c_str()));
+  class_names_[name] = &script_class;
+  return script_class;
+}
+
+PythonSystem::ScriptClass &PythonSystem::script_class(py::object cls) {
+  auto it = classes_.find(cls.ptr());
+  if ( it != classes_.end() ) {
+    return it->second;
+  }
+  ScriptClass &script_class = classes_[cls.ptr()];
+  script_class.cls = cls;
+  script_class.pool_size = py::extract<size_t>(py::getattr(cls, "_pool_size", py::object(0)));
+  // Instances are indexed under each class in the MRO that is an entity.
+  py::object entity_base = py::import("_entityx").attr("Entity");
+  py::object mro = cls.attr("__mro__");
+  for ( py::ssize_t i = 0; i < py::len(mro); ++i ) {
+    py::object base = mro[i];
+    if ( base.ptr() != entity_base.ptr() && PyObject_IsSubclass(base.ptr(), entity_base.ptr()) == 1 ) {
+      script_class.indexes.push_back(instances(base));
     }
   }
+  return script_class;
 }
 }  // namespace python
 }  // namespace entityx
@@ -13,13 +13,32 @@
  // http://docs.python.org/2/extending/extending.html
 #include <boost/python.hpp>
 #include <boost/function.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <list>
+#include <memory>
 #include <vector>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include "entityx/System.h"
 #include "entityx/Entity.h"
 #include "entityx/Event.h"
 
+// PythonSystem, its event proxies and Boost.Python rely on the GIL to
+// serialise access to Python objects and to their own state.
+#ifdef Py_GIL_DISABLED
+#error "entityx::python does not support free-threaded CPython builds"
+#endif
+
 namespace entityx {
 namespace python {
 /**
@@ -58,8 +77,114 @@ private:
   void unpack_args() {}
 };
 
+#ifndef ENTITYX_PYTHON_COMPONENT_FAMILIES
+#define ENTITYX_PYTHON_COMPONENT_FAMILIES 16
+#endif
+
+/**
+ * Storage for a component implemented in Python, as a subclass of
+ * entityx.PythonComponent.
+ *
+ * Each such class is bound to one instantiation of this template when it is
+ * defined, so it has its own component family and pool like a C++ component.
+ * At most ENTITYX_PYTHON_COMPONENT_FAMILIES classes may be defined. From C++
+ * use python_component() and each_python_component().
+ */
+template <size_t N>
+struct PythonComponent {
+  explicit PythonComponent(boost::python::object object) : object(object) {}
+  // Copied by value like C++ components, eg. by create_from_copy(), rather
+  // than sharing the Python object.
+  PythonComponent(const PythonComponent &other)
+    : object(boost::python::import("copy").attr("copy")(other.object)) {}
+  PythonComponent(PythonComponent &&other) = default;
+
+  boost::python::object object;
+};
+
+/**
+ * Return the component of Python class cls of an entity, or None.
+ */
+boost::python::object python_component(EntityManager &entity_manager, Entity::Id id,
+                                       const boost::python::object &cls);
+
+/**
+ * Call f(entity, component) for each entity with a component of Python class
+ * cls, in pool order.
+ */
+void each_python_component(EntityManager &entity_manager, const boost::python::object &cls,
+                           const std::function<void(Entity, const boost::python::object &)> &f);
+
+namespace detail {
+// The component to assign for a Python object recorded by CommandBuffer.
+template <typename Component>
+struct RecordedComponent {
+  static const Component &get(const boost::python::object &component) {
+    return boost::python::extract<const Component&>(component)();
+  }
+};
+
+template <size_t N>
+struct RecordedComponent<PythonComponent<N>> {
+  static PythonComponent<N> get(const boost::python::object &component) {
+    return PythonComponent<N>(component);
+  }
+};
+
+// A module of the entityx Python package compiled into the library, as
+// generated by cmake/entityx_python_freeze.py. frozen_modules ends with an
+// entry whose name is null.
+struct FrozenModule {
+  const char *name;
+  const unsigned char *code;
+  int size;
+  bool is_package;
+};
+
+class StartupProfile;
+}  // namespace detail
+
 class PythonSystem;
 
+/**
+ * The live instances of a Python entity class and its subclasses, in no
+ * particular order. Maintained by PythonSystem, and exposed to Python as a
+ * sequence by Entity.instances().
+ */
+class InstanceIndex {
+public:
+  size_t size() const { return objects_.size(); }
+  const boost::python::object &operator [] (size_t i) const { return objects_[i]; }
+
+  void add(Entity::Id id, const boost::python::object &object);
+  // Remove the instance of entity id, moving the last instance into its place.
+  void remove(Entity::Id id);
+
+private:
+  std::vector<boost::python::object> objects_;
+  std::vector<Entity::Id> ids_;
+  std::unordered_map<uint64_t, size_t> positions_;
+};
+
+/**
+ * Makes the world of a PythonSystem current in the entityx Python package
+ * while in scope, so that module-level operations (creating entities,
+ * entities_with(), emit(), ...) apply to it. The previous world is restored
+ * afterwards.
+ *
+ * PythonSystem enters its own world around update(), script creation and
+ * destruction, and event delivery by BroadcastPythonEventProxy. Custom
+ * proxies should do the same with their python_system.
+ */
+class PythonWorldScope {
+public:
+  explicit PythonWorldScope(PythonSystem *system);
+  ~PythonWorldScope();
+
+private:
+  PythonSystem *previous_;
+};
+
 /**
  * Proxies C++ EntityX events to Python entities.
  */
@@ -73,7 +198,7 @@ public:
    * @param handler_name The default implementation of can_send() tests for
    *     the existence of this attribute on an Entity.
    */
-  explicit PythonEventProxy(const std::string &handler_name) : handler_name(handler_name) {}
+  explicit PythonEventProxy(const std::string &handler_name) : handler_name(handler_name), python_system(nullptr) {}
   virtual ~PythonEventProxy() {}
 
   /**
@@ -88,6 +213,8 @@ public:
 protected:
   std::list<Entity> entities;
   const std::string handler_name;
+  // The PythonSystem the proxy was added to.
+  PythonSystem *python_system;
 
 private:
   /**
@@ -114,14 +241,259 @@ private:
   }
 };
 
+/**
+ * Records world mutations issued from Python, to be applied later.
+ *
+ * When PythonSystem::defer_mutations() is enabled, Entity.destroy() and the
+ * assign_to() and remove_from() helpers record into this buffer rather than
+ * modifying the EntityManager. The buffer is applied at the end of
+ * PythonSystem::update(). Applied commands have the same preconditions as
+ * the immediate operations, eg. assigning a component that the entity
+ * already has is an error.
+ */
+class CommandBuffer {
+public:
+  CommandBuffer() : suspended_(0) {}
+
+  /**
+   * Return the buffer recording mutations of entity_manager, or nullptr if
+   * mutations should be applied immediately.
+   */
+  static CommandBuffer *recording_for(const EntityManager &entity_manager);
+
+  void destroy(Entity::Id id) {
+    commands_.push_back(Command{&apply_destroy, id, boost::python::object()});
+  }
+
+  template <typename Component>
+  void assign(Entity::Id id, const boost::python::object &component) {
+    commands_.push_back(Command{&apply_assign<Component>, id, component});
+  }
+
+  template <typename Component>
+  void remove(Entity::Id id) {
+    commands_.push_back(Command{&apply_remove<Component>, id, boost::python::object()});
+  }
+
+  /**
+   * Apply and clear all recorded commands, including any recorded while
+   * applying. Commands for entities that have since been destroyed are
+   * skipped.
+   */
+  void apply(EntityManager &entity_manager);
+
+  size_t size() const { return commands_.size(); }
+
+  // Temporarily apply mutations immediately, eg. while an entity is being
+  // constructed.
+  void suspend() { suspended_++; }
+  void resume() { suspended_--; }
+  bool suspended() const { return suspended_ > 0; }
+
+private:
+  struct Command {
+    void (*apply)(EntityManager &, Entity::Id, const boost::python::object &);
+    Entity::Id id;
+    // The Python component to copy from, for assignments.
+    boost::python::object component;
+  };
+
+  static void apply_destroy(EntityManager &entity_manager, Entity::Id id, const boost::python::object &) {
+    entity_manager.destroy(id);
+  }
+
+  template <typename Component>
+  static void apply_assign(EntityManager &entity_manager, Entity::Id id, const boost::python::object &component) {
+    // As when assigned immediately, the entity must not already have one.
+    assert(!entity_manager.has_component<Component>(id) && "deferred assign_to() of a component the entity already has");
+    entity_manager.assign<Component>(id, detail::RecordedComponent<Component>::get(component));
+  }
+
+  template <typename Component>
+  static void apply_remove(EntityManager &entity_manager, Entity::Id id, const boost::python::object &) {
+    if ( entity_manager.has_component<Component>(id) ) {
+      entity_manager.remove<Component>(id);
+    }
+  }
+
+  std::vector<Command> commands_;
+  int suspended_;
+};
+
 /**
  * A helper function for class_ to assign a component to an entity.
  */
 template <typename Component>
-void assign_to(Component& component, EntityManager& entity_manager, Entity::Id id) {
-  entity_manager.assign<Component>(id, component);
+void assign_to(boost::python::back_reference<Component&> component, EntityManager& entity_manager, Entity::Id id) {
+  if ( CommandBuffer *commands = CommandBuffer::recording_for(entity_manager) ) {
+    commands->assign<Component>(id, component.source());
+    return;
+  }
+  entity_manager.assign<Component>(id, component.get());
+}
+
+/**
+ * A helper function for class_ to remove a component from an entity.
+ */
+template <typename Component>
+void remove_from(EntityManager& entity_manager, Entity::Id id) {
+  if ( CommandBuffer *commands = CommandBuffer::recording_for(entity_manager) ) {
+    commands->remove<Component>(id);
+    return;
+  }
+  entity_manager.remove<Component>(id);
 }
 
+/**
+ * The number of components in each chunk of an EntityX component pool. This
+ * must match the default ChunkSize of entityx::Pool.
+ */
+static const size_t COMPONENT_POOL_CHUNK_SIZE = 8192;
+
+namespace detail {
+// Changed entity indices for one component type in one EntityManager.
+struct ChangedBits {
+  const EntityManager *entity_manager;
+  // The first byte and first entity index of each pool chunk that Python
+  // has references into.
+  std::vector<std::pair<const char *, size_t>> chunks;
+  std::vector<uint64_t> bits;
+
+  void set(size_t index) {
+    if ( index / 64 >= bits.size() ) {
+      bits.resize(index / 64 + 1, 0);
+    }
+    bits[index / 64] |= uint64_t(1) << (index % 64);
+  }
+};
+
+// Register bits with clear_changed_components().
+void add_changed_bits(ChangedBits *bits);
+}  // namespace detail
+
+/**
+ * Clear the changed components of all types in an EntityManager. Called by
+ * PythonSystem::update() before scripts run.
+ */
+void clear_changed_components(const EntityManager &entity_manager);
+
+/**
+ * Entities whose Component had a field set from Python, through a property
+ * generated by export_component(), since the last clear().
+ *
+ *     for ( Entity entity : ChangedComponents<Position>(entities) ) { ... }
+ *
+ * Components modified in other ways (def_readwrite properties, component
+ * arrays) are not tracked.
+ */
+template <typename Component>
+class ChangedComponents {
+public:
+  class Iterator : public std::iterator<std::input_iterator_tag, Entity> {
+  public:
+    Iterator(EntityManager *entity_manager, const std::vector<uint64_t> *bits, size_t index)
+        : entity_manager_(entity_manager), bits_(bits), index_(index) { next(); }
+
+    Iterator &operator ++ () {
+      ++index_;
+      next();
+      return *this;
+    }
+    bool operator == (const Iterator &other) const { return index_ == other.index_; }
+    bool operator != (const Iterator &other) const { return index_ != other.index_; }
+    Entity operator * () const { return entity_manager_->get(entity_manager_->create_id(index_)); }
+
+  private:
+    // Advance to the next set bit of an entity that still has the component.
+    void next() {
+      const size_t end = bits_->size() * 64;
+      while ( index_ < end ) {
+        const uint64_t word = (*bits_)[index_ / 64] >> (index_ % 64);
+        if ( !word ) {
+          index_ = (index_ / 64 + 1) * 64;
+        } else if ( (word & 1) && entity_manager_->has_component<Component>(entity_manager_->create_id(index_)) ) {
+          return;
+        } else {
+          ++index_;
+        }
+      }
+      index_ = end;
+    }
+
+    EntityManager *entity_manager_;
+    const std::vector<uint64_t> *bits_;
+    size_t index_;
+  };
+
+  explicit ChangedComponents(EntityManager &entity_manager)
+      : entity_manager_(entity_manager), bits_(bits_for(entity_manager)) {}
+
+  Iterator begin() const { return Iterator(&entity_manager_, &bits_.bits, 0); }
+  Iterator end() const { return Iterator(&entity_manager_, &bits_.bits, bits_.bits.size() * 64); }
+
+  bool changed(Entity::Id id) const {
+    const size_t index = id.index();
+    return index / 64 < bits_.bits.size() && (bits_.bits[index / 64] >> (index % 64)) & 1;
+  }
+
+  void clear() { std::fill(bits_.bits.begin(), bits_.bits.end(), 0); }
+
+  /**
+   * Remember the pool chunk holding component, the Component of entity id,
+   * so that changes made through Python references to it can be attributed.
+   */
+  static void track(const EntityManager &entity_manager, Entity::Id id, const Component *component) {
+    const size_t chunk_size = COMPONENT_POOL_CHUNK_SIZE;
+    const size_t first = id.index() - id.index() % chunk_size;
+    const char *base = reinterpret_cast<const char*>(component) - (id.index() - first) * sizeof(Component);
+    detail::ChangedBits &bits = bits_for(entity_manager);
+    for ( auto &chunk : bits.chunks ) {
+      if ( chunk.second == first ) {
+        chunk.first = base;
+        return;
+      }
+    }
+    bits.chunks.emplace_back(base, first);
+  }
+
+  /**
+   * Mark the entity owning component as changed. Components that are not in
+   * a tracked pool chunk, such as ones not yet assigned, are ignored.
+   */
+  static void mark(const Component &component) {
+    const size_t chunk_size = COMPONENT_POOL_CHUNK_SIZE;
+    const char *address = reinterpret_cast<const char*>(&component);
+    for ( auto &bits : all_bits() ) {
+      for ( auto &chunk : bits->chunks ) {
+        if ( address >= chunk.first && address < chunk.first + chunk_size * sizeof(Component) ) {
+          bits->set(chunk.second + (address - chunk.first) / sizeof(Component));
+          return;
+        }
+      }
+    }
+  }
+
+private:
+  static std::vector<std::unique_ptr<detail::ChangedBits>> &all_bits() {
+    static std::vector<std::unique_ptr<detail::ChangedBits>> all;
+    return all;
+  }
+
+  static detail::ChangedBits &bits_for(const EntityManager &entity_manager) {
+    for ( auto &bits : all_bits() ) {
+      if ( bits->entity_manager == &entity_manager ) {
+        return *bits;
+      }
+    }
+    all_bits().emplace_back(new detail::ChangedBits{&entity_manager, {}, {}});
+    detail::add_changed_bits(all_bits().back().get());
+    return *all_bits().back();
+  }
+
+  EntityManager &entity_manager_;
+  detail::ChangedBits &bits_;
+};
+
 /**
  * A helper function for retrieving an existing component associated with an
  * entity.
@@ -134,6 +506,407 @@ static Component* get_component(EntityManager& em, Entity::Id id) {
   return handle.get();
 }
 
+/**
+ * The HeldType of components exposed with export_component().
+ *
+ * A component constructed from Python is owned by its reference. One returned
+ * from an entity refers to the component in its pool, and checks the entity
+ * version and component mask on each access, raising ReferenceError once the
+ * entity is destroyed or the component removed.
+ */
+template <typename Component>
+class ComponentRef {
+public:
+  typedef Component element_type;
+
+  explicit ComponentRef(Component *owned = nullptr)
+      : owned_(owned), component_(owned), entity_manager_(nullptr) {}
+
+  ComponentRef(EntityManager &entity_manager, Entity::Id id, Component *component)
+      : component_(component), entity_manager_(&entity_manager), id_(id) {}
+
+  Component *get() const {
+    if ( entity_manager_ && !(entity_manager_->valid(id_) && entity_manager_->has_component<Component>(id_)) ) {
+      PyErr_SetString(PyExc_ReferenceError, "component is no longer attached to its entity");
+      boost::python::throw_error_already_set();
+    }
+    return component_;
+  }
+
+private:
+  std::shared_ptr<Component> owned_;
+  Component *component_;
+  EntityManager *entity_manager_;
+  Entity::Id id_;
+};
+
+template <typename Component>
+Component *get_pointer(const ComponentRef<Component> &ref) {
+  return ref.get();
+}
+
+/**
+ * get_component() for components exposed with export_component(). Returns a
+ * ComponentRef, or None.
+ */
+template <typename Component>
+boost::python::object get_component_ref(EntityManager& em, Entity::Id id) {
+  Component *component = get_component<Component>(em, id);
+  if ( !component ) {
+    return boost::python::object();
+  }
+  // Only exported components have tracked field setters.
+  ChangedComponents<Component>::track(em, id, component);
+  return boost::python::object(ComponentRef<Component>(em, id, component));
+}
+
+/**
+ * Type-erased access to a component type, for Python entity queries.
+ */
+struct ComponentAccessor {
+  // Append the IDs of all entities that have the component.
+  void (*collect)(EntityManager &, std::vector<Entity::Id> &);
+  bool (*has)(EntityManager &, Entity::Id);
+  // Return a Python reference to the component of an entity.
+  boost::python::object (*get)(EntityManager &, Entity::Id);
+
+  template <typename Component>
+  static ComponentAccessor of() {
+    return of<Component>(&get_reference<Component>);
+  }
+
+  // With a custom conversion of components to Python.
+  template <typename Component>
+  static ComponentAccessor of(boost::python::object (*get)(EntityManager &, Entity::Id)) {
+    return ComponentAccessor{&collect_ids<Component>, &has_component<Component>, get};
+  }
+
+  /**
+   * Return the accessor registered for a Python component class, or nullptr.
+   */
+  static const ComponentAccessor *find(PyObject *cls);
+  static void add(PyTypeObject *cls, const ComponentAccessor &accessor);
+
+private:
+  template <typename Component>
+  static void collect_ids(EntityManager &entity_manager, std::vector<Entity::Id> &ids) {
+    for ( Entity entity : entity_manager.entities_with_components<Component>() ) {
+      ids.push_back(entity.id());
+    }
+  }
+
+  template <typename Component>
+  static bool has_component(EntityManager &entity_manager, Entity::Id id) {
+    return entity_manager.has_component<Component>(id);
+  }
+
+  template <typename Component>
+  static boost::python::object get_reference(EntityManager &entity_manager, Entity::Id id) {
+    return boost::python::object(boost::python::ptr(entity_manager.component<Component>(id).get()));
+  }
+};
+
+/**
+ * Register a component so that it can be used in Python entity queries
+ * (entityx.entities_with()). Call after the component's class_ definition.
+ */
+template <typename Component>
+void register_component() {
+  ComponentAccessor::add(boost::python::converter::registered<Component>::converters.get_class_object(),
+                         ComponentAccessor::of<Component>());
+}
+
+/**
+ * A helper function for class_ to expose the storage of a component pool to
+ * Python without copying.
+ *
+ * Returns a list of (first_index, view, mask) tuples, one for each chunk of
+ * the pool that holds at least one component. view is a writable memoryview
+ * over the raw storage of the chunk, starting at entity index first_index,
+ * and mask is a bytearray with a non-zero byte for each index that has the
+ * component. Views remain valid until the EntityManager is reset.
+ */
+template <typename Component>
+boost::python::list component_array(EntityManager& entity_manager) {
+  const size_t chunk_size = COMPONENT_POOL_CHUNK_SIZE;
+  boost::python::list chunks;
+  char *base = nullptr;
+  size_t chunk = 0;
+  PyObject *mask = nullptr;
+
+  auto finish_chunk = [&]() {
+    boost::python::object mask_object((boost::python::handle<>(mask)));
+    Py_buffer buffer;
+    if ( PyBuffer_FillInfo(&buffer, NULL, base, chunk_size * sizeof(Component), 0, PyBUF_WRITABLE | PyBUF_ND) == -1 ) {
+      boost::python::throw_error_already_set();
+    }
+    boost::python::object view(boost::python::handle<>(PyMemoryView_FromBuffer(&buffer)));
+    chunks.append(boost::python::make_tuple(chunk * chunk_size, view, mask_object));
+  };
+
+  for ( Entity entity : entity_manager.entities_with_components<Component>() ) {
+    const size_t index = entity.id().index();
+    char *component = reinterpret_cast<char*>(entity.component<Component>().get());
+    if ( !base || index / chunk_size != chunk ) {
+      if ( base ) {
+        finish_chunk();
+      }
+      chunk = index / chunk_size;
+      base = component - (index % chunk_size) * sizeof(Component);
+      mask = PyByteArray_FromStringAndSize(NULL, chunk_size);
+      if ( !mask ) {
+        boost::python::throw_error_already_set();
+      }
+      std::fill_n(PyByteArray_AS_STRING(mask), chunk_size, 0);
+    }
+    assert(component == base + (index % chunk_size) * sizeof(Component) &&
+           "COMPONENT_POOL_CHUNK_SIZE does not match the EntityX pool layout");
+    PyByteArray_AS_STRING(mask)[index % chunk_size] = 1;
+  }
+  if ( base ) {
+    finish_chunk();
+  }
+  return chunks;
+}
+
+/**
+ * Converts component fields to and from Python.
+ *
+ * The generic implementation uses the Boost.Python converter registry.
+ * Specialisations for arithmetic types call the Python C API directly.
+ */
+template <typename T, typename Enable = void>
+struct FieldConverter {
+  static boost::python::object to_python(const T &value) {
+    return boost::python::object(value);
+  }
+
+  static T from_python(const boost::python::object &value) {
+    return boost::python::extract<T>(value);
+  }
+};
+
+template <typename T>
+struct FieldConverter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static boost::python::object to_python(T value) {
+    return boost::python::object(boost::python::handle<>(PyFloat_FromDouble(value)));
+  }
+
+  static T from_python(const boost::python::object &value) {
+    double result = PyFloat_AsDouble(value.ptr());
+    if ( result == -1.0 && PyErr_Occurred() ) {
+      boost::python::throw_error_already_set();
+    }
+    return static_cast<T>(result);
+  }
+};
+
+template <>
+struct FieldConverter<bool> {
+  static boost::python::object to_python(bool value) {
+    return boost::python::object(boost::python::handle<>(PyBool_FromLong(value)));
+  }
+
+  static bool from_python(const boost::python::object &value) {
+    int result = PyObject_IsTrue(value.ptr());
+    if ( result == -1 ) {
+      boost::python::throw_error_already_set();
+    }
+    return result != 0;
+  }
+};
+
+template <typename T>
+struct FieldConverter<T, typename std::enable_if<std::is_same<T, int>::value || std::is_same<T, long>::value>::type> {
+  static boost::python::object to_python(T value) {
+#if PY_MAJOR_VERSION >= 3
+    return boost::python::object(boost::python::handle<>(PyLong_FromLong(value)));
+#else
+    return boost::python::object(boost::python::handle<>(PyInt_FromLong(value)));
+#endif
+  }
+
+  static T from_python(const boost::python::object &value) {
+    long result = PyLong_AsLong(value.ptr());
+    if ( result == -1 && PyErr_Occurred() ) {
+      boost::python::throw_error_already_set();
+    }
+    if ( result < std::numeric_limits<T>::min() || result > std::numeric_limits<T>::max() ) {
+      PyErr_SetString(PyExc_OverflowError, "value out of range for component field");
+      boost::python::throw_error_already_set();
+    }
+    return static_cast<T>(result);
+  }
+};
+
+/**
+ * A component field to be exposed by export_component(). See field().
+ */
+template <typename Component, typename T>
+struct ComponentField {
+  const char *name;
+  T Component::*member;
+
+  boost::python::object get(Component &component) const {
+    return FieldConverter<T>::to_python(component.*member);
+  }
+
+  void set(Component &component, const boost::python::object &value) const {
+    component.*member = FieldConverter<T>::from_python(value);
+    ChangedComponents<Component>::mark(component);
+  }
+};
+
+/**
+ * Describe a component field for export_component().
+ */
+template <typename Component, typename T>
+ComponentField<Component, T> field(const char *name, T Component::*member) {
+  return ComponentField<Component, T>{name, member};
+}
+
+namespace detail {
+template <typename Component, typename T>
+struct FieldGetter {
+  ComponentField<Component, T> field;
+
+  boost::python::object operator () (Component &component) const {
+    return field.get(component);
+  }
+};
+
+template <typename Component, typename T>
+struct FieldSetter {
+  ComponentField<Component, T> field;
+
+  void operator () (Component &component, const boost::python::object &value) const {
+    field.set(component, value);
+  }
+};
+
+template <typename Class>
+void export_fields(Class &cls) {}
+
+template <size_t ...I>
+struct indices {};
+
+template <size_t N, size_t ...I>
+struct make_indices : make_indices<N - 1, N - 1, I...> {};
+
+template <size_t ...I>
+struct make_indices<0, I...> {
+  typedef indices<I...> type;
+};
+
+template <typename ...Components>
+struct indices_for : make_indices<sizeof...(Components)> {};
+
+template <typename F, typename Tuple, size_t ...I>
+void apply_run(F &f, const Tuple &first, size_t n, indices<I...>) {
+  f(std::get<I>(first)..., n);
+}
+
+template <typename Class, typename Component, typename T, typename ...Fields>
+void export_fields(Class &cls, const ComponentField<Component, T> &field, Fields ... fields) {
+  cls.add_property(
+    field.name,
+    boost::python::make_function(FieldGetter<Component, T>{field}, boost::python::default_call_policies(),
+                                 boost::mpl::vector<boost::python::object, Component&>()),
+    boost::python::make_function(FieldSetter<Component, T>{field}, boost::python::default_call_policies(),
+                                 boost::mpl::vector<void, Component&, const boost::python::object&>()));
+  export_fields(cls, fields...);
+}
+}  // namespace detail
+
+/**
+ * Expose a component to Python.
+ *
+ * This defines a class_ with the assign_to, remove_from, get_component and
+ * component_array helpers and a property for each field, and registers the
+ * component for entity queries. Field accessors for arithmetic types convert
+ * values directly rather than through the Boost.Python converter registry.
+ *
+ * Instances are held by ComponentRef, so Python references to components
+ * of an entity are checked before each access.
+ *
+ *     export_component<Position>("Position", py::init<py::optional<float, float>>(),
+ *                                field("x", &Position::x), field("y", &Position::y));
+ *
+ * @returns The class_, for further definitions.
+ */
+template <typename Component, typename ...InitArgs, typename ...Fields>
+boost::python::class_<Component, ComponentRef<Component>> export_component(
+    const char *name, const boost::python::init<InitArgs...> &init, Fields ... fields) {
+  boost::python::class_<Component, ComponentRef<Component>> cls(name, init);
+  cls
+    .def("assign_to", &assign_to<Component>)
+    .def("remove_from", &remove_from<Component>)
+    .staticmethod("remove_from")
+    .def("get_component", &get_component_ref<Component>)
+    .staticmethod("get_component")
+    .def("component_array", &component_array<Component>)
+    .staticmethod("component_array");
+  detail::export_fields(cls, fields...);
+  ComponentAccessor::add(boost::python::converter::registered<Component>::converters.get_class_object(),
+                         ComponentAccessor::of<Component>(&get_component_ref<Component>));
+  return cls;
+}
+
+/**
+ * Expose a default-constructible component to Python. See above.
+ */
+template <typename Component, typename ...Fields>
+boost::python::class_<Component, ComponentRef<Component>> export_component(const char *name, Fields ... fields) {
+  return export_component<Component>(name, boost::python::init<>(), fields...);
+}
+
+/**
+ * A native kernel callable from Python as entityx.kernels.<name>(args...).
+ *
+ * It receives the EntityManager of the calling world and the Python
+ * arguments.
+ */
+typedef std::function<void(EntityManager &, const boost::python::tuple &)> Kernel;
+
+/**
+ * Register a kernel under name, replacing any existing kernel of that name.
+ */
+void register_kernel(const std::string &name, Kernel kernel);
+
+/**
+ * Call f(components..., n) for each run of consecutive entities that have all
+ * of Components. Each argument points to n contiguous components in their
+ * pools, suitable for vectorised processing.
+ */
+template <typename ...Components, typename F>
+void for_each_run(EntityManager &entity_manager, F f) {
+  const size_t chunk_size = COMPONENT_POOL_CHUNK_SIZE;
+  std::tuple<Components*...> first;
+  size_t start = 0, n = 0;
+  auto flush = [&]() {
+    if ( n ) {
+      detail::apply_run(f, first, n, typename detail::indices_for<Components...>::type());
+    }
+  };
+  for ( Entity entity : entity_manager.entities_with_components<Components...>() ) {
+    const size_t index = entity.id().index();
+    if ( n && index == start + n && index % chunk_size != 0 ) {
+      n++;
+      continue;
+    }
+    flush();
+    first = std::make_tuple(entity.component<Components>().get()...);
+    start = index;
+    n = 1;
+  }
+  flush();
+}
+
+/**
+ * y[i] += a * x[i] for i in [0, n), using AVX or SSE where available.
+ */
+void axpy(float *y, const float *x, float a, size_t n);
+
 /**
  * A PythonEventProxy that broadcasts events to all entities with a matching
  * handler method.
@@ -145,6 +918,7 @@ public:
   virtual ~BroadcastPythonEventProxy() {}
 
   void receive(const Event &event) {
+    PythonWorldScope scope(python_system);
     for ( auto entity : entities ) {
       auto py_entity = entity.template component<PythonScript>();
       py_entity->object.attr(handler_name.c_str())(event);
@@ -152,6 +926,69 @@ public:
   }
 };
 
+/**
+ * A lock-free, multiple-producer single-consumer queue of deferred entity
+ * creation requests.
+ *
+ * Requests may be pushed from any thread. The consumer takes all pending
+ * requests at once and runs them in the order they were pushed.
+ */
+class SpawnQueue {
+public:
+  typedef std::function<void(Entity)> Spawn;
+
+  SpawnQueue() : head_(nullptr) {}
+  SpawnQueue(const SpawnQueue &) = delete;
+  SpawnQueue &operator = (const SpawnQueue &) = delete;
+
+  ~SpawnQueue() {
+    Node *node = head_.load(std::memory_order_acquire);
+    while ( node ) {
+      Node *next = node->next;
+      delete node;
+      node = next;
+    }
+  }
+
+  /**
+   * Queue a request. Safe to call from any thread.
+   */
+  void push(Spawn spawn) {
+    Node *node = new Node(std::move(spawn));
+    node->next = head_.load(std::memory_order_relaxed);
+    while ( !head_.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                         std::memory_order_relaxed) ) {}
+  }
+
+  /**
+   * Create an entity for each pending request and pass it to the request.
+   *
+   * Must only be called from one thread at a time. If a request throws, the
+   * requests after it are discarded.
+   */
+  void consume(EntityManager &entities) {
+    Node *node = head_.exchange(nullptr, std::memory_order_acquire);
+    // The stack is newest-first, so reverse it.
+    std::vector<std::unique_ptr<Node>> nodes;
+    for ( ; node; node = node->next ) {
+      nodes.emplace_back(node);
+    }
+    for ( auto i = nodes.rbegin(); i != nodes.rend(); ++i ) {
+      (*i)->spawn(entities.create());
+    }
+  }
+
+private:
+  struct Node {
+    explicit Node(Spawn spawn) : spawn(std::move(spawn)), next(nullptr) {}
+
+    Spawn spawn;
+    Node *next;
+  };
+
+  std::atomic<Node*> head_;
+};
+
 /**
  * An entityx::System that bridges EntityX and Python.
  *
@@ -159,7 +996,11 @@ public:
  * support differs in design from the C++ design in the following ways:
  *
  * - Entities contain logic and can receive events.
- * - Systems and Components can not be implemented in Python.
+ * - Systems implemented in Python subclass entityx.BatchSystem, are added
+ *   with add_batch_system(), and are updated once per frame after the
+ *   entity scripts.
+ * - Components implemented in Python subclass entityx.PythonComponent, and
+ *   are stored in native pools as PythonComponent<N>.
  */
 class PythonSystem : public entityx::System<PythonSystem>, public entityx::Receiver<PythonSystem> {
 public:
@@ -170,6 +1011,9 @@ public:
 
   /**
    * Add system-installed entityx Python path to the interpreter.
+   *
+   * Not needed if the entityx package is frozen into the library
+   * (ENTITYX_PYTHON_FREEZE_PACKAGE).
    */
   void add_installed_library_path();
 
@@ -178,6 +1022,16 @@ public:
    */
   void add_path(const std::string &path);
 
+  /**
+   * Add a zip bundle of precompiled scripts, as built by the
+   * entityx_python_bundle() CMake function.
+   *
+   * Bundles are searched before the paths added with add_path(), and their
+   * modules are imported from the archive's in-memory index without
+   * touching the filesystem for each lookup.
+   */
+  void add_bundle(const std::string &path);
+
   /**
    * Add a sequence of paths to the interpreter.
    */
@@ -188,6 +1042,53 @@ public:
     }
   }
 
+  /**
+   * Queue modules to import ahead of their first use.
+   *
+   * Queued modules are imported at the start of update(), as many per frame
+   * as fit in the preload budget (at least one), and the entity classes they
+   * define are cached, so that the first PythonScript using them does not
+   * have to import the module. Modules that fail to import are reported to
+   * stderr and skipped.
+   */
+  template <typename T>
+  void preload(const T &modules) {
+    for ( auto module : modules ) {
+      preload_.push_back(module);
+    }
+  }
+
+  /**
+   * Reload changed script modules without restarting, keeping live state.
+   *
+   * Each module is re-executed, and the live instances of the classes it
+   * redefines (scripted and pooled entities, batch systems and Python
+   * components) in every world are switched to the new classes with their
+   * state intact. __slots__ values are carried over by name, components
+   * declared only by the new class are created, and the instance indexes and
+   * event proxy registrations of the entities are updated. Classes that the
+   * new version of a module no longer defines are left alone, as are modules
+   * that import names from a reloaded module.
+   */
+  template <typename T>
+  void reload(const T &modules) {
+    std::vector<std::string> names;
+    for ( auto module : modules ) {
+      names.push_back(module);
+    }
+    reload_modules(names);
+  }
+
+  /// Set the time update() may spend importing preloaded modules per frame.
+  void preload_budget(TimeDelta seconds) {
+    preload_budget_ = std::chrono::duration<double>(seconds);
+  }
+
+  /// Return the number of queued modules that have not been imported yet.
+  size_t pending_preloads() const {
+    return preload_.size();
+  }
+
   /// Return the Python paths the system is configured with.
   const std::vector<std::string> &python_paths() const {
     return python_paths_;
@@ -201,12 +1102,50 @@ public:
    */
   void log_to(LoggerFunction sout, LoggerFunction serr);
 
+  /**
+   * Profile the startup of the next PythonSystem to be constructed.
+   *
+   * The report times Py_Initialize(), init_entityx(), configure() and each
+   * sys.path insertion it makes, and every module imported until
+   * finish_startup_profile(), nested under the import that caused it. It is
+   * written to json_path as JSON, or to the stdout logger as an indented tree
+   * if json_path is empty.
+   *
+   * Imports are timed by replacing __import__, so only one system can be
+   * profiled at a time.
+   */
+  static void profile_startup(const std::string &json_path = "");
+
+  /**
+   * Return the interpreter to its state when the first PythonSystem was
+   * constructed, so that the next session starts afresh and the memory of
+   * the previous one is reclaimed.
+   *
+   * Boost.Python does not support Py_Finalize(), so the interpreter and the
+   * built-in modules registered with PyImport_AppendInittab() (_entityx and
+   * the game's own) are kept. Every other module imported since is dropped,
+   * sys.path is restored, Python component classes are unregistered, the
+   * entityx.submit() worker processes are stopped, and garbage is collected.
+   * Scripts are imported again by the next PythonSystem.
+   *
+   * Must only be called when no PythonSystem, and no EntityManager holding
+   * Python objects, exists.
+   */
+  static void reset_interpreter();
+
+  /**
+   * Stop profiling startup and write the report. Called at the end of the
+   * first update(). Does nothing if startup is not being profiled.
+   */
+  void finish_startup_profile();
+
   /**
    * Proxy events of type Event to any Python entity with a handler_name method.
    */
   template <typename Event>
   void add_event_proxy(EventManager& event_manager, const std::string &handler_name) {
     std::shared_ptr<BroadcastPythonEventProxy<Event>> proxy(new BroadcastPythonEventProxy<Event>(handler_name));
+    proxy->python_system = this;
     event_manager.subscribe<Event>(*proxy.get());
     event_proxies_.push_back(std::static_pointer_cast<PythonEventProxy>(proxy));
   }
@@ -216,21 +1155,151 @@ public:
    */
   template <typename Event, typename Proxy>
   void add_event_proxy(EventManager& event_manager, std::shared_ptr<Proxy> proxy) {
+    proxy->python_system = this;
     event_manager.subscribe<Event>(*proxy);
     event_proxies_.push_back(std::static_pointer_cast<PythonEventProxy>(proxy));
   }
 
+  /**
+   * Add a Python system, a subclass of entityx.BatchSystem.
+   *
+   * The class is instantiated on the first update(). Its update() is then
+   * called once per frame, after the entity scripts, with an iterator over
+   * all entities that have the components it declares.
+   */
+  void add_batch_system(const std::string &module, const std::string &cls);
+
+  /**
+   * Queue creation of a scripted entity. Safe to call from any thread.
+   *
+   * The entity is created, and a PythonScript with the given arguments is
+   * assigned to it, at the start of the next update().
+   */
+  template <typename ...Args>
+  void spawn(const std::string &module, const std::string &cls, Args ... args) {
+    spawn_queue_.push([=](Entity entity) {
+      entity.assign<PythonScript>(module, cls, args...);
+    });
+  }
+
+  /**
+   * Queue creation of an entity. Safe to call from any thread.
+   *
+   * At the start of the next update() an entity is created and passed to
+   * setup, on the thread calling update(). This allows C++ components to be
+   * assigned before PythonScript.
+   */
+  void spawn(SpawnQueue::Spawn setup) {
+    spawn_queue_.push(std::move(setup));
+  }
+
+  /**
+   * Defer mutations issued from Python until the end of update().
+   *
+   * While enabled, Entity.destroy() and the assign_to() and remove_from()
+   * component helpers record commands instead of modifying the
+   * EntityManager, so entities and components are not destroyed or removed
+   * under scripts iterating over them. Entity creation, and components
+   * assigned while constructing a Python entity, are not deferred, so the
+   * EntityManager is still modified during update() and must not be read
+   * from other threads meanwhile.
+   */
+  void defer_mutations(bool defer);
+
+  /**
+   * Apply any deferred mutations now.
+   */
+  void apply_commands();
+
+  /**
+   * Create n copies of a scripted prototype entity.
+   *
+   * C++ components are copied with EntityManager::create_from_copy(), and
+   * Python components with copy.copy(). The Python instance is
+   * shallow-copied, without calling its constructor.
+   *
+   * Entities copied with EntityManager::create_from_copy() directly have
+   * their Python instance cloned at the start of the next update().
+   */
+  std::vector<Entity> clone(Entity prototype, size_t n = 1);
+
+  /**
+   * Return the index of live instances of a Python entity class, including
+   * instances of its subclasses.
+   */
+  std::shared_ptr<InstanceIndex> instances(const boost::python::object &cls);
+
   void receive(const EntityDestroyedEvent &event);
   void receive(const ComponentAddedEvent<PythonScript> &event);
 
 private:
+  friend class PythonWorldScope;
+  friend class PythonEntityQuery;
+
+  /**
+   * A cached Python entity class, and its pool of instances parked for reuse.
+   */
+  struct ScriptClass {
+    boost::python::object cls;
+    size_t pool_size;
+    std::vector<boost::python::object> pool;
+    // Instance indexes of the class and its entity base classes.
+    std::vector<std::shared_ptr<InstanceIndex>> indexes;
+  };
+
+  struct BatchSystem {
+    std::string module, cls;
+    boost::python::object object;
+  };
+
   void initialize_python_module();
+  // Make this the world of the _entityx module.
+  void activate();
+  ScriptClass &script_class(const std::string &module, const std::string &cls);
+  ScriptClass &script_class(boost::python::object cls);
+  void script_created(Entity entity, const boost::python::object &object);
+  void unregister_command_buffer();
+  void finish_clones();
+  void update_batch_systems(TimeDelta dt);
+  void import_preloads();
+  void cache_script_classes(const std::string &module_name, boost::python::object module);
+  void reload_modules(const std::vector<std::string> &modules);
+  // Old classes of reloaded modules by address, with their new versions.
+  typedef std::unordered_map<PyObject*, std::pair<boost::python::object, boost::python::object>> ReplacedClasses;
+  // Switch the instances and caches of this world to the new classes.
+  void replace_classes(const ReplacedClasses &replaced);
 
   EntityManager& em_;
+  EventManager *event_manager_;
   std::vector<std::string> python_paths_;
+  std::vector<std::string> bundles_;
   LoggerFunction stdout_, stderr_;
+  boost::python::object stdout_logger_, stderr_logger_;
   static bool initialized_;
+  // The PythonSystems that exist.
+  static std::vector<PythonSystem*> systems_;
+  // The system whose world is current in the _entityx module.
+  static PythonSystem *active_;
   std::vector<std::shared_ptr<PythonEventProxy>> event_proxies_;
+  std::unordered_map<PyObject*, ScriptClass> classes_;
+  std::unordered_map<std::string, ScriptClass*> class_names_;
+  // Instance indexes by class. The class is held so that its address is not
+  // reused by another class while it is a key.
+  std::unordered_map<PyObject*, std::pair<boost::python::object, std::shared_ptr<InstanceIndex>>> instance_indexes_;
+  // Copied entities, and the prototype instance to clone for each.
+  std::vector<std::pair<Entity, boost::python::object>> pending_clones_;
+  std::vector<BatchSystem> batch_systems_;
+  std::deque<std::string> preload_;
+  std::chrono::duration<double> preload_budget_;
+  SpawnQueue spawn_queue_;
+  CommandBuffer commands_;
+  bool defer_mutations_;
+  std::unique_ptr<detail::StartupProfile> startup_profile_;
+  // Expires when the system is destroyed, for Python objects that refer to
+  // its world.
+  std::shared_ptr<void> alive_;
+  // Identifies the world to Python, such as to entityx.jobs. Never reused.
+  size_t world_;
 };
 }  // namespace python
 }  // namespace entityx
@@ -17,9 +17,12 @@
 #include <string>
 #include <iostream>
 #include <memory>
+#include <chrono>
+#include <thread>
 #include "entityx/python/3rdparty/catch.hpp"
 #include "entityx/entityx.h"
 #include "entityx/python/PythonSystem.h"
+#include "entityx/python/config.h"
 
 namespace py = boost::python;
 using std::cerr;
@@ -39,6 +42,15 @@ struct Direction {
   float x, y;
 };
 
+struct Health {
+  explicit Health(int health = 100) : health(health), regeneration(0.5), alive(true) {}
+
+  int health;
+  double regeneration;
+  bool alive;
+  std::string name;
+};
+
 struct CollisionEvent : public Event<CollisionEvent> {
   CollisionEvent(Entity a, Entity b) : a(a), b(b) {}
 
@@ -61,19 +73,33 @@ struct CollisionEventProxy : public PythonEventProxy, public Receiver<CollisionE
 BOOST_PYTHON_MODULE(entityx_python_test) {
   py::class_<Position>("Position", py::init<py::optional<float, float>>())
     .def("assign_to", &assign_to<Position>)
+    .def("remove_from", &remove_from<Position>)
+    .staticmethod("remove_from")
+    .def("component_array", &component_array<Position>)
+    .staticmethod("component_array")
     .def("get_component", &get_component<Position>,
          py::return_value_policy<py::reference_existing_object>())
     .staticmethod("get_component")
     .def_readwrite("x", &Position::x)
     .def_readwrite("y", &Position::y);
+  register_component<Position>();
 
   py::class_<Direction>("Direction", py::init<py::optional<float, float>>())
     .def("assign_to", &assign_to<Direction>)
+    .def("remove_from", &remove_from<Direction>)
+    .staticmethod("remove_from")
     .def("get_component", &get_component<Direction>,
          py::return_value_policy<py::reference_existing_object>())
     .staticmethod("get_component")
     .def_readwrite("x", &Direction::x)
     .def_readwrite("y", &Direction::y);
+  register_component<Direction>();
+
+  export_component<Health>("Health", py::init<py::optional<int>>(),
+                           field("health", &Health::health),
+                           field("regeneration", &Health::regeneration),
+                           field("alive", &Health::alive),
+                           field("name", &Health::name));
 
   py::class_<CollisionEvent>("Collision", py::init<Entity, Entity>())
     .add_property("a", py::make_getter(&CollisionEvent::a, py::return_value_policy<py::return_by_value>()))
@@ -267,3 +293,722 @@ TEST_CASE_METHOD(PythonSystemTest, "TestEventEmissionFromPython") {
     REQUIRE(false);
   }
 }
+
+TEST_CASE_METHOD(PythonSystemTest, "TestSlottedEntity") {
+  try {
+    Entity e = entity_manager.create();
+    auto script = e.assign<PythonScript>("entityx.tests.slots_test", "SlotsTest");
+    REQUIRE(static_cast<bool>(e.component<Position>()));
+    script->object.attr("test_slots")();
+
+    Entity e2 = entity_manager.create();
+    auto script2 = e2.assign<PythonScript>("entityx.tests.slots_test", "SlotsSubclassTest");
+    REQUIRE(static_cast<bool>(e2.component<Direction>()));
+    script2->object.attr("test_slots_subclass")();
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestPooledEntityReuse") {
+  try {
+    Entity e = entity_manager.create();
+    py::object object = e.assign<PythonScript>("entityx.tests.pool_test", "PooledEntity", 1.0)->object;
+    e.destroy();
+    REQUIRE(py::extract<int>(object.attr("resets")) == 1);
+
+    Entity e2 = entity_manager.create();
+    auto script = e2.assign<PythonScript>("entityx.tests.pool_test", "PooledEntity", 2.0);
+    REQUIRE(script->object.ptr() == object.ptr());
+    Entity::Id id = py::extract<Entity::Id>(object.attr("_entity_id"));
+    REQUIRE(id == e2.id());
+    REQUIRE(e2.component<Position>()->x == 2.0);
+
+    // The pool is full, so further instances are not parked.
+    Entity e3 = entity_manager.create();
+    py::object object3 = e3.assign<PythonScript>("entityx.tests.pool_test", "PooledEntity", 3.0)->object;
+    e2.destroy();
+    e3.destroy();
+    REQUIRE(py::extract<int>(object3.attr("resets")) == 0);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestPooledEntitySlotsSeenByReset") {
+  try {
+    Entity e = entity_manager.create();
+    py::object object = e.assign<PythonScript>("entityx.tests.pool_test", "PooledSlotsEntity", "enemy")->object;
+    e.destroy();
+    REQUIRE(py::extract<std::string>(object.attr("reset_target"))() == "enemy");
+    // Slots of parked instances are kept, like their __dict__.
+    REQUIRE(py::object(object.attr("target")).is_none());
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestPooledEntityFailingReset") {
+  try {
+    const size_t size = entity_manager.size();
+    Entity e = entity_manager.create();
+    py::object object = e.assign<PythonScript>("entityx.tests.pool_test", "FailingResetEntity")->object;
+    // The error is reported, and the entity is still destroyed.
+    e.destroy();
+    REQUIRE(!e.valid());
+    REQUIRE(entity_manager.size() == size);
+
+    // The instance was not parked for reuse.
+    Entity e2 = entity_manager.create();
+    auto script = e2.assign<PythonScript>("entityx.tests.pool_test", "FailingResetEntity");
+    REQUIRE(script->object.ptr() != object.ptr());
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestEntityClone") {
+  try {
+    py::object test = py::import("entityx.tests.clone_test");
+    test.attr("clone_test")();
+
+    Entity prototype = entity_manager.create();
+    prototype.assign<PythonScript>("entityx.tests.constructor_test", "ConstructorTest", 4.0, 5.0);
+    std::vector<Entity> clones = python.clone(prototype, 2);
+    REQUIRE(clones.size() == 2);
+    for ( Entity clone : clones ) {
+      REQUIRE(clone.component<Position>()->x == 4.0);
+      Entity::Id id = py::extract<Entity::Id>(clone.component<PythonScript>()->object.attr("_entity_id"));
+      REQUIRE(id == clone.id());
+    }
+
+    // Copies made with create_from_copy() are completed on update.
+    Entity copy = entity_manager.create_from_copy(prototype);
+    REQUIRE(!copy.component<PythonScript>()->object);
+    python.update(entity_manager, event_manager, 0.0);
+    REQUIRE(copy.component<PythonScript>()->object);
+
+    // Copies destroyed, or whose script is removed, before then are skipped.
+    Entity destroyed = entity_manager.create_from_copy(prototype);
+    Entity unscripted = entity_manager.create_from_copy(prototype);
+    destroyed.destroy();
+    unscripted.remove<PythonScript>();
+    python.update(entity_manager, event_manager, 0.0);
+    REQUIRE(!destroyed.valid());
+    REQUIRE(!unscripted.component<PythonScript>());
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestSpawnFromWorkerThreads") {
+  try {
+    std::vector<std::thread> workers;
+    for ( int i = 0; i < 4; ++i ) {
+      workers.emplace_back([this, i]() {
+        for ( int j = 0; j < 25; ++j ) {
+          python.spawn("entityx.tests.constructor_test", "ConstructorTest",
+                       static_cast<float>(i), static_cast<float>(j));
+        }
+        python.spawn([](Entity entity) {
+          entity.assign<Position>(-1, -1);
+          entity.assign<PythonScript>("entityx.tests.assign_test", "AssignTest");
+        });
+      });
+    }
+    for ( auto &worker : workers ) {
+      worker.join();
+    }
+    REQUIRE(entity_manager.size() == 0);
+
+    python.update(entity_manager, event_manager, 0.0);
+    REQUIRE(entity_manager.size() == 104);
+    size_t existing = 0;
+    entity_manager.each<PythonScript, Position>(
+      [&](Entity entity, PythonScript &script, Position &position) {
+      REQUIRE(script.object);
+      if ( position.x == -1 ) {
+        existing++;
+      }
+    });
+    REQUIRE(existing == 4);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestDeferredMutations") {
+  try {
+    python.defer_mutations(true);
+    Entity e = entity_manager.create();
+    e.assign<PythonScript>("entityx.tests.deferred_test", "DeferredTest");
+    Entity victim = entity_manager.create();
+    victim.assign<PythonScript>("entityx.tests.deferred_test", "Victim");
+    REQUIRE(static_cast<bool>(e.component<Position>()));
+
+    // DeferredTest.update() asserts that its mutations have not been applied yet.
+    python.update(entity_manager, event_manager, 0.0);
+    REQUIRE(!e.component<Position>());
+    REQUIRE(e.component<Direction>()->x == 1.0);
+    REQUIRE(!victim.valid());
+
+    python.defer_mutations(false);
+    Entity f = entity_manager.create();
+    auto script2 = f.assign<PythonScript>("entityx.tests.update_test", "UpdateTest");
+    script2->object.attr("destroy")();
+    REQUIRE(!f.valid());
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestComponentArray") {
+  try {
+    Entity a = entity_manager.create();
+    a.assign<Position>(1, 2);
+    entity_manager.create();
+    Entity c = entity_manager.create();
+    c.assign<Position>(3, 4);
+
+    py::object test = py::import("entityx.tests.component_array_test");
+    test.attr("component_array_test")(a.id().index(), c.id().index());
+    REQUIRE(c.component<Position>()->x == 5.0);
+    REQUIRE(c.component<Position>()->y == 6.0);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestEntitiesWithFromPython") {
+  try {
+    entity_manager.create().assign<Position>(1, 0);
+    Entity both = entity_manager.create();
+    both.assign<Position>(2, 0);
+    both.assign<Direction>(3, 0);
+    entity_manager.create().assign<Direction>(4, 0);
+    Entity scripted = entity_manager.create();
+    auto script = scripted.assign<PythonScript>("entityx.tests.deep_subclass_test", "DeepSubclassTest");
+
+    py::object test = py::import("entityx.tests.entities_with_test");
+    test.attr("entities_with_test")(both.id(), script->object);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestExportComponent") {
+  try {
+    Entity e = entity_manager.create();
+    auto script = e.assign<PythonScript>("entityx.tests.export_component_test", "HealthTest");
+    auto health = e.component<Health>();
+    REQUIRE(static_cast<bool>(health));
+    REQUIRE(health->health == 50);
+    script->object.attr("test_fields")();
+    REQUIRE(health->health == 40);
+    REQUIRE(health->regeneration == 1.5);
+    REQUIRE(!health->alive);
+    REQUIRE(health->name == "bob");
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestComponentHandles") {
+  try {
+    py::object test = py::import("entityx.tests.export_component_test");
+    Entity removed = entity_manager.create();
+    py::object removed_health = removed.assign<PythonScript>(
+      "entityx.tests.export_component_test", "HandleTest")->object.attr("health");
+    Entity destroyed = entity_manager.create();
+    py::object destroyed_health = destroyed.assign<PythonScript>(
+      "entityx.tests.export_component_test", "HandleTest")->object.attr("health");
+    REQUIRE(py::extract<int>(removed_health.attr("health"))() == 100);
+    REQUIRE(py::extract<Health&>(removed_health)().health == 100);
+
+    removed.remove<Health>();
+    test.attr("expect_reference_error")(removed_health);
+    destroyed.destroy();
+    test.attr("expect_reference_error")(destroyed_health);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestChangedComponents") {
+  try {
+    Entity healthy = entity_manager.create();
+    healthy.assign<Health>(100);
+    Entity wounded = entity_manager.create();
+    wounded.assign<Health>(5);
+
+    py::object test = py::import("entityx.tests.changed_test");
+    test.attr("construct_unassigned")();
+    test.attr("damage_wounded")();
+
+    ChangedComponents<Health> changed(entity_manager);
+    std::vector<Entity> entities(changed.begin(), changed.end());
+    REQUIRE(entities.size() == 1);
+    REQUIRE(entities[0] == wounded);
+    REQUIRE(wounded.component<Health>()->health == 4);
+    REQUIRE(changed.changed(wounded.id()));
+    REQUIRE(!changed.changed(healthy.id()));
+
+    changed.clear();
+    REQUIRE(changed.begin() == changed.end());
+
+    test.attr("damage_wounded")();
+    REQUIRE(changed.changed(wounded.id()));
+    python.update(entity_manager, event_manager, 0.0);
+    REQUIRE(changed.begin() == changed.end());
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestPythonComponent") {
+  try {
+    py::object test = py::import("entityx.tests.python_component_test");
+    py::object inventory_class = test.attr("Inventory");
+    Entity player = entity_manager.create();
+    py::object script = player.assign<PythonScript>("entityx.tests.python_component_test", "PlayerTest")->object;
+    Entity tagged = entity_manager.create();
+    test.attr("tag")(tagged.id());
+
+    python.update(entity_manager, event_manager, 0.0);
+    py::object inventory = python_component(entity_manager, player.id(), inventory_class);
+    REQUIRE(py::extract<int>(inventory.attr("capacity"))() == 20);
+    REQUIRE(py::len(inventory.attr("items")) == 1);
+    REQUIRE(python_component(entity_manager, tagged.id(), inventory_class).is_none());
+
+    std::vector<Entity> entities;
+    each_python_component(entity_manager, test.attr("Tag"), [&](Entity entity, const py::object &tag) {
+      entities.push_back(entity);
+    });
+    REQUIRE(entities.size() == 1);
+    REQUIRE(entities[0] == tagged);
+
+    test.attr("python_component_test")(script);
+    test.attr("redefinition_test")(tagged.id());
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestBatchSystem") {
+  try {
+    Entity moving = entity_manager.create();
+    moving.assign<Position>(1, 2);
+    moving.assign<Direction>(2, 4);
+    Entity still = entity_manager.create();
+    still.assign<Position>(1, 2);
+
+    python.add_batch_system("entityx.tests.batch_system_test", "MovementSystem");
+    python.add_batch_system("entityx.tests.batch_system_test", "EmptySystem");
+    python.update(entity_manager, event_manager, 0.5);
+    python.update(entity_manager, event_manager, 0.5);
+
+    REQUIRE(moving.component<Position>()->x == 3.0f);
+    REQUIRE(moving.component<Position>()->y == 6.0f);
+    REQUIRE(still.component<Position>()->x == 1.0f);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestGetEntityById") {
+  try {
+    Entity destroyed = entity_manager.create();
+    Entity::Id destroyed_id = destroyed.id();
+    destroyed.destroy();
+    // Reuses the index of the destroyed entity, with a new version.
+    Entity scripted = entity_manager.create();
+    auto script = scripted.assign<PythonScript>("entityx.tests.deep_subclass_test", "DeepSubclassTest");
+    REQUIRE(scripted.id().index() == destroyed_id.index());
+    Entity plain = entity_manager.create();
+
+    py::object test = py::import("entityx.tests.get_test");
+    test.attr("get_test")(script->object, plain.id(), destroyed_id);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestClassInstances") {
+  try {
+    py::object test = py::import("entityx.tests.instances_test");
+    Entity turret = entity_manager.create();
+    turret.assign<PythonScript>("entityx.tests.instances_test", "Turret");
+    entity_manager.create().assign<PythonScript>("entityx.tests.instances_test", "BigTurret");
+    entity_manager.create().assign<PythonScript>("entityx.tests.instances_test", "Wall");
+    test.attr("create_turret")();
+    test.attr("check_instances")(3, 1, 1);
+
+    turret.destroy();
+    test.attr("check_instances")(2, 1, 1);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestMultipleWorlds") {
+  try {
+    EventManager other_event_manager;
+    EntityManager other_entity_manager(other_event_manager);
+    PythonSystem other(other_entity_manager);
+    other.configure(other_event_manager);
+
+    py::object parent = entity_manager.create().assign<PythonScript>(
+      "entityx.tests.worlds_test", "Parent")->object;
+    std::vector<py::object> other_parents;
+    for ( int i = 0; i < 2; ++i ) {
+      other_parents.push_back(other_entity_manager.create().assign<PythonScript>(
+        "entityx.tests.worlds_test", "Parent")->object);
+    }
+
+    // Children were created in the world of their parent.
+    REQUIRE(entity_manager.size() == 2);
+    REQUIRE(other_entity_manager.size() == 4);
+
+    python.update(entity_manager, event_manager, 0.0);
+    other.update(other_entity_manager, other_event_manager, 0.0);
+    REQUIRE(py::extract<int>(parent.attr("seen"))() == 1);
+    REQUIRE(py::extract<int>(other_parents[1].attr("seen"))() == 2);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestEntitiesWithAfterWorldDestroyed") {
+  try {
+    py::object query;
+    {
+      EventManager other_event_manager;
+      EntityManager other_entity_manager(other_event_manager);
+      PythonSystem other(other_entity_manager);
+      other.configure(other_event_manager);
+      other_entity_manager.create().assign<Position>(1, 0);
+
+      PythonWorldScope scope(&other);
+      query = py::import("entityx").attr("entities_with")(py::import("entityx_python_test").attr("Position"));
+    }
+    py::import("entityx.tests.worlds_test").attr("stale_query_test")(query);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestSubmitJobs") {
+  try {
+    for ( int i = 1; i <= 3; ++i ) {
+      entity_manager.create().assign<Position>(i, 0);
+    }
+    py::object test = py::import("entityx.tests.jobs_test");
+    py::tuple submitted = py::extract<py::tuple>(test.attr("submit")());
+
+    // Futures are resolved by update() once the workers finish.
+    for ( int i = 0; i < 1000; ++i ) {
+      python.update(entity_manager, event_manager, 0.0);
+      if ( submitted[0].attr("done")() && submitted[1].attr("done")() ) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    test.attr("check")(*submitted);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestSubmitJobsFromOtherWorld") {
+  try {
+    EventManager other_event_manager;
+    EntityManager other_entity_manager(other_event_manager);
+    PythonSystem other(other_entity_manager);
+    other.configure(other_event_manager);
+    other_entity_manager.create().assign<Position>(1, 0);
+    other_entity_manager.create().assign<Position>(2, 0);
+    entity_manager.create().assign<Position>(3, 0);
+
+    py::object test = py::import("entityx.tests.jobs_test");
+    py::tuple submitted;
+    {
+      PythonWorldScope scope(&other);
+      submitted = py::extract<py::tuple>(test.attr("submit_counting")());
+    }
+    py::object future = submitted[0];
+
+    // Only the submitting world resolves the future.
+    for ( int i = 0; i < 20; ++i ) {
+      python.update(entity_manager, event_manager, 0.0);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(!future.attr("done")());
+    for ( int i = 0; i < 1000 && !future.attr("done")(); ++i ) {
+      other.update(other_entity_manager, other_event_manager, 0.0);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(py::len(submitted[1]) == 1);
+    REQUIRE(py::extract<int>(submitted[1][0])() == 2);
+    py::import("entityx.jobs").attr("shutdown")();
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestPreloadModules") {
+  try {
+    py::object modules = py::import("sys").attr("modules");
+    REQUIRE(!modules.contains("entityx.tests.preload_test"));
+    std::vector<std::string> preload = {"entityx.tests.preload_test", "entityx.tests.no_such_module"};
+    python.preload(preload);
+    python.preload_budget(1.0);
+    REQUIRE(python.pending_preloads() == 2);
+
+    python.update(entity_manager, event_manager, 0.0);
+    REQUIRE(python.pending_preloads() == 0);
+    REQUIRE(modules.contains("entityx.tests.preload_test"));
+    Entity e = entity_manager.create();
+    e.assign<PythonScript>("entityx.tests.preload_test", "PreloadTest");
+    REQUIRE(!e.component<PythonScript>()->object.is_none());
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+#ifdef ENTITYX_PYTHON_FREEZE_PACKAGE
+TEST_CASE_METHOD(PythonSystemTest, "TestFrozenPackage") {
+  try {
+    py::object test = py::import("entityx.tests.frozen_test");
+    test.attr("check_frozen")();
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+#endif
+
+TEST_CASE_METHOD(PythonSystemTest, "TestScriptBundle") {
+  try {
+    py::object test = py::import("entityx.tests.bundle_test");
+    const std::string bundle = py::extract<std::string>(
+      test.attr("make_bundle")(ENTITYX_PYTHON_TEST_DATA "../../cmake/entityx_python_bundle.py"));
+
+    EventManager bundled_event_manager;
+    EntityManager bundled_entity_manager(bundled_event_manager);
+    PythonSystem bundled(bundled_entity_manager);
+    bundled.add_bundle(bundle);
+    bundled.configure(bundled_event_manager);
+
+    Entity e = bundled_entity_manager.create();
+    auto script = e.assign<PythonScript>("bundled_scripts.entities", "Bundled");
+    test.attr("check_bundled")(script->object, bundle);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestReloadScripts") {
+  try {
+    py::object test = py::import("entityx.tests.reload_test");
+    test.attr("write_module")(py::object(test.attr("VERSION_1")));
+    Entity e = entity_manager.create();
+    Entity f = entity_manager.create();
+    auto script = e.assign<PythonScript>("reloadable", "Reloaded");
+    f.assign<PythonScript>("reloadable", "Reloaded");
+    f.destroy();
+    py::object counter = script->object.attr("counter");
+    test.attr("prepare")(script->object);
+    // Instances in other worlds are switched too.
+    EventManager other_event_manager;
+    EntityManager other_entity_manager(other_event_manager);
+    PythonSystem other(other_entity_manager);
+    other.configure(other_event_manager);
+    py::object other_object = other_entity_manager.create().assign<PythonScript>("reloadable", "Reloaded")->object;
+
+    python.reload(std::vector<std::string>{"reloadable"});
+    test.attr("check_reloaded")(script->object, counter);
+    REQUIRE(py::object(other_object.attr("__class__")).ptr() == py::object(script->object.attr("__class__")).ptr());
+    // The new class handles events, and replaces the old one for new entities.
+    event_manager.emit<CollisionEvent>(e, f);
+    REQUIRE(script->object.attr("collided"));
+    Entity g = entity_manager.create();
+    auto created = g.assign<PythonScript>("reloadable", "Reloaded");
+    REQUIRE(py::object(created->object.attr("__class__")).ptr() == py::object(script->object.attr("__class__")).ptr());
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestStartupProfile") {
+  try {
+    const std::string path = py::extract<std::string>(py::import("tempfile").attr("mktemp")(".json"));
+    PythonSystem::profile_startup(path);
+
+    EventManager profiled_event_manager;
+    EntityManager profiled_entity_manager(profiled_event_manager);
+    PythonSystem profiled(profiled_entity_manager);
+    profiled.add_path(ENTITYX_PYTHON_TEST_DATA);
+    profiled.configure(profiled_event_manager);
+    Entity e = profiled_entity_manager.create();
+    e.assign<PythonScript>("entityx.tests.profile_test", "Profiled");
+    profiled.update(profiled_entity_manager, profiled_event_manager, 0.0);
+
+    py::object test = py::import("entityx.tests.profile_test");
+    test.attr("check_profile")(path, ENTITYX_PYTHON_TEST_DATA);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE_METHOD(PythonSystemTest, "TestKernels") {
+  static_assert(sizeof(Position) == 2 * sizeof(float) && sizeof(Direction) == 2 * sizeof(float),
+                "integrate treats Position and Direction as float arrays");
+  register_kernel("integrate", [](EntityManager &entity_manager, const py::tuple &args) {
+    float dt = py::extract<float>(args[2]);
+    for_each_run<Position, Direction>(entity_manager, [dt](Position *position, Direction *direction, size_t n) {
+      axpy(&position->x, &direction->x, dt, 2 * n);
+    });
+  });
+  try {
+    // Two runs of moving entities, split by one that has no Direction.
+    std::vector<Entity> moving;
+    Entity stopped;
+    for ( int i = 0; i < 21; ++i ) {
+      Entity e = entity_manager.create();
+      e.assign<Position>(i, 0);
+      if ( i != 10 ) {
+        e.assign<Direction>(2, i);
+        moving.push_back(e);
+      } else {
+        stopped = e;
+      }
+    }
+
+    py::object test = py::import("entityx.tests.kernels_test");
+    test.attr("kernels_test")();
+
+    for ( Entity e : moving ) {
+      auto position = e.component<Position>();
+      auto direction = e.component<Direction>();
+      REQUIRE(position->x == direction->y + 1.0f);
+      REQUIRE(position->y == direction->y * 0.5f);
+    }
+    REQUIRE(stopped.component<Position>()->x == 10.0f);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
+
+TEST_CASE("TestResetInterpreter") {
+  try {
+    py::object script_class;
+    {
+      EventManager event_manager;
+      EntityManager entity_manager(event_manager);
+      PythonSystem python(entity_manager);
+      python.add_path(ENTITYX_PYTHON_TEST_DATA);
+      python.configure(event_manager);
+      auto script = entity_manager.create().assign<PythonScript>("entityx.tests.reset_test", "ResetTest");
+      script_class = py::import("weakref").attr("ref")(py::object(script->object.attr("__class__")));
+    }
+    PythonSystem::reset_interpreter();
+
+    // Script modules and their classes are gone, built-in modules are kept.
+    REQUIRE(script_class().is_none());
+    py::object sys = py::import("sys");
+    py::object modules = sys.attr("modules");
+    REQUIRE(!modules.contains("entityx.tests.reset_test"));
+    REQUIRE(!modules.contains("entityx"));
+    REQUIRE(!sys.attr("path").contains(ENTITYX_PYTHON_TEST_DATA));
+
+    EventManager event_manager;
+    EntityManager entity_manager(event_manager);
+    PythonSystem python(entity_manager);
+    python.add_path(ENTITYX_PYTHON_TEST_DATA);
+    python.configure(event_manager);
+    auto script = entity_manager.create().assign<PythonScript>("entityx.tests.reset_test", "ResetTest");
+    REQUIRE(py::extract<float>(script->object.attr("position").attr("x"))() == 1.0f);
+  }
+  catch ( ... ) {
+    PyErr_Print();
+    PyErr_Clear();
+    REQUIRE(false);
+  }
+}
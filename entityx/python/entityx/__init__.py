@@ -1,6 +1,3 @@
-import _entityx
-
-
 """These classes provide a convenience layer on top of the raw entityx::python
 primitives.
 
@@ -17,10 +14,59 @@ They allow you to declare your entities and components in an intuitive way:
 
 Note that components assigned from C++ must be assigned prior to assigning
 PythonComponent, otherwise they will be created by the Entity constructor.
+
+Entities that declare __slots__ store their components and the listed
+attributes in fixed slots rather than in a per-instance __dict__:
+
+    class Bullet(Entity):
+        __slots__ = ('owner', 'damage')
+        position = Component(Position)
 """
 
+import sys
+from pkgutil import extend_path
+
+import _entityx
+
+
+class _FrozenSubmoduleImporter(object):
+    """Import the submodules of the package when it is frozen on Python 2.
+
+    Python 2 gives a frozen package a __path__ that only admits frozen
+    submodules. This importer, on sys.meta_path, loads those from the
+    frozen modules, and leaves the others, such as entityx.tests, to be
+    found on the package's __path__, which is replaced with the entityx
+    directories on sys.path.
+    """
 
-__all__ = ['Entity', 'Component']
+    def find_module(self, fullname, path=None):
+        if not fullname.startswith(__name__ + '.'):
+            return None
+        if imp.is_frozen(fullname):
+            return self
+        # Directories may have been added to sys.path since the last lookup.
+        __path__[:] = extend_path([], __name__)
+        return None
+
+    def load_module(self, fullname):
+        if fullname in sys.modules:
+            return sys.modules[fullname]
+        return imp.init_frozen(fullname)
+
+
+# The package may be frozen into the entityx_python library, in which case
+# subpackages such as entityx.tests are still looked up on sys.path.
+if isinstance(__path__, str):
+    import imp
+    sys.meta_path[:] = [importer for importer in sys.meta_path
+                        if type(importer).__name__ != _FrozenSubmoduleImporter.__name__]
+    sys.meta_path.append(_FrozenSubmoduleImporter())
+    __path__ = extend_path([], __name__)
+else:
+    __path__ = extend_path(__path__, __name__)
+
+
+__all__ = ['Entity', 'Component', 'PythonComponent', 'BatchSystem', 'clone', 'get', 'component_array', 'entities_with', 'kernels', 'submit']
 
 
 class Component(object):
@@ -42,21 +88,93 @@ class Component(object):
 
     def _build(self, entity_id):
         component = self._cls.get_component(_entityx._entity_manager, entity_id)
-        if not component:
+        if component is None:
             component = self._cls(*self._args, **self._kwargs)
             component.assign_to(_entityx._entity_manager, entity_id)
             return self._build(entity_id)
         return component
 
 
+class PythonComponentMetaClass(type):
+    """Bind each PythonComponent subclass to a native component family."""
+
+    def __init__(cls, name, bases, dct):
+        super(PythonComponentMetaClass, cls).__init__(name, bases, dct)
+        if bases != (object,):
+            _entityx._register_python_component(cls)
+
+
+class PythonComponent(object):
+    """Base class for components implemented in Python.
+
+    Instances are stored in native EntityX component pools, so they can be
+    used with Component, entities_with() and from C++ (see
+    entityx::python::python_component()), like C++ components:
+
+        class Inventory(PythonComponent):
+            def __init__(self, capacity=10):
+                self.capacity = capacity
+                self.items = []
+
+        class Player(Entity):
+            inventory = Component(Inventory, 20)
+    """
+
+    __metaclass__ = PythonComponentMetaClass
+
+    def assign_to(self, entity_manager, entity_id):
+        _entityx._python_component_assign_to(self, entity_manager, entity_id)
+
+    @classmethod
+    def remove_from(cls, entity_manager, entity_id):
+        _entityx._python_component_remove_from(cls, entity_manager, entity_id)
+
+    @classmethod
+    def get_component(cls, entity_manager, entity_id):
+        return _entityx._python_component_get_component(cls, entity_manager, entity_id)
+
+
+class BatchSystem(object):
+    """Base class for systems implemented in Python.
+
+    Add with PythonSystem::add_batch_system(). update() is called once per
+    frame with an iterator over all entities that have the declared
+    components, rather than once per entity:
+
+        class Movement(BatchSystem):
+            components = (Position, Direction)
+
+            def update(self, entities, dt):
+                for entity, position, direction in entities:
+                    position.x += direction.x * dt
+    """
+
+    components = ()
+
+    def update(self, entities, dt):
+        """Called once per frame. entities is None if no components are
+        declared.
+        """
+
+    def _update(self, dt):
+        entities = entities_with(*self.components) if self.components else None
+        self.update(entities, dt)
+
+
 class EntityMetaClass(_entityx.Entity.__class__):
     """Collect registered components from class attributes.
 
     This is done at class creation time to reduce entity creation overhead.
+
+    If the class declares __slots__, its components and the declared names are
+    replaced with _entityx.Slot descriptors. CPython does not support
+    non-empty __slots__ on Boost.Python subclasses, so the values live in the
+    underlying C++ entity instead.
     """
 
     def __new__(cls, name, bases, dct):
         dct['_components'] = components = {}
+        slots = dct.pop('__slots__', None)
         # Collect components from base classes
         for base in bases:
             if '_components' in base.__dict__:
@@ -65,6 +183,21 @@ class EntityMetaClass(_entityx.Entity.__class__):
         for key, value in dct.items():
             if isinstance(value, Component):
                 components[key] = value
+        # Collect slots from base classes
+        slotted_bases = [base for base in bases if getattr(base, '_slot_names', ())]
+        if len(slotted_bases) > 1:
+            raise TypeError('%s: multiple bases declare __slots__' % name)
+        slot_names = slotted_bases[0]._slot_names if slotted_bases else ()
+        # Allocate slots for our own components and declared attributes
+        if slots is not None:
+            if isinstance(slots, str):
+                slots = (slots,)
+            own = [key for key, value in dct.items() if isinstance(value, Component)]
+            own.extend(slots)
+            for index, key in enumerate(own, len(slot_names)):
+                dct[key] = _entityx.Slot(index, key)
+            slot_names += tuple(own)
+        dct['_slot_names'] = slot_names
         return type.__new__(cls, name, bases, dct)
 
 
@@ -83,13 +216,30 @@ class Entity(_entityx.Entity):
         if entity_id is None:
             entity_id = _entityx._entity_manager.configure(self)
         _entityx.Entity.__init__(self, _entityx._entity_manager, entity_id)
-        for k, v in self._components.items():
-            setattr(self, k, v._build(self._entity_id))
+        self._build_components()
         return self
 
     def __init__(self):
         """Default constructor."""
 
+    def reset(self):
+        """Called when an instance of a pooled class is parked for reuse.
+
+        A class opts in to pooling by setting _pool_size to the maximum number
+        of instances to keep. Pooled instances are reused by entities created
+        from C++, so scripts must not hold on to destroyed entities.
+        """
+
+    @classmethod
+    def instances(cls):
+        """Return the live instances of this class and its subclasses.
+
+        The result is a sequence that is updated as entities are created and
+        destroyed, in no particular order. Destroying entities while
+        iterating over it may skip others; iterate over a copy instead.
+        """
+        return _entityx._python_system.instances(cls)
+
     def __repr__(self):
         return '<%s.%s %d.%d>' % (self.__class__.__module__, self.__class__.__name__, self._entity_id.index, self._entity_id.version)
 
@@ -103,6 +253,127 @@ class Entity(_entityx.Entity):
         cls.__init__(self, *args, **kwargs)
         return self
 
+    def _reuse(self, entity_id, *args, **kwargs):
+        """Bind a pooled instance to a new raw entity.
+
+        This is called from C++.
+        """
+        self._rebind(_entityx._entity_manager, entity_id)
+        self._build_components()
+        self.__class__.__init__(self, *args, **kwargs)
+
+    def _clone(self, entity_id):
+        """Create a copy of this entity for entity_id.
+
+        This is called from C++, once the C++ components of the entity have
+        been copied to entity_id.
+        """
+        clone = _entityx.Entity.__new__(self.__class__)
+        _entityx.Entity.__init__(clone, _entityx._entity_manager, entity_id)
+        clone._copy_state(self)
+        clone._build_components()
+        return clone
+
+    def _build_components(self):
+        # Components of an entity under construction are never deferred.
+        commands = _entityx._commands
+        if commands is not None:
+            commands.suspend()
+        try:
+            for k, v in self._components.items():
+                setattr(self, k, v._build(self._entity_id))
+        finally:
+            if commands is not None:
+                commands.resume()
+
+
+def clone(prototype, n=1):
+    """Create n copies of a configured entity.
+
+    C++ components are copied natively, Python components with copy.copy(),
+    and the Python state of prototype is shallow-copied. Constructors are not
+    called.
+
+    :param prototype: The Entity to copy.
+    :returns: A list of the new entities.
+    """
+    return _entityx._python_system.clone(prototype, n)
+
+
+def get(entity_id):
+    """Return the Python entity with the given EntityId.
+
+    :returns: The entity, or None if it has been destroyed or is not a Python
+        entity.
+    """
+    return _entityx._entity_manager.get(entity_id)
+
+
+def component_array(cls):
+    """Return zero-copy views over the storage of a C++ component pool.
+
+    The component class must expose the component_array() helper.
+
+    :param cls: A Python-exposed C++ component class.
+    :returns: A list of (first_index, view, mask) tuples, one per pool chunk.
+        view is a writable memoryview of raw component storage starting at
+        entity index first_index, and mask has a non-zero byte for each index
+        that has the component. Component i of a chunk occupies bytes
+        [i * size, (i + 1) * size) of view, where size is
+        len(view) // len(mask).
+    """
+    return cls.component_array(_entityx._entity_manager)
+
+
+def entities_with(*components):
+    """Iterate over all entities that have the given components.
+
+    Components must have been registered with
+    entityx::python::register_component<Component>().
+
+        for entity, position, direction in entities_with(Position, Direction):
+            position.x += direction.x
+
+    :returns: An iterator of (entity, component...) tuples. entity is the
+        Python entity for scripted entities, otherwise its EntityId.
+    """
+    return _entityx._entity_manager.entities_with(components)
+
+
+class _Kernels(object):
+    """Native kernels registered with entityx::python::register_kernel().
+
+    Each kernel runs over every matching entity in one call:
+
+        entityx.kernels.integrate(Position, Direction, dt)
+    """
+
+    def __getattr__(self, name):
+        if name.startswith('_') or not _entityx.has_kernel(name):
+            raise AttributeError(name)
+
+        def kernel(*args):
+            return _entityx._entity_manager.run_kernel(name, args)
+        kernel.__name__ = name
+        setattr(self, name, kernel)
+        return kernel
+
+
+kernels = _Kernels()
+
+
+def submit(fn, args=(), components=()):
+    """Run fn(*args) in a worker process. See entityx.jobs.
+
+    :param components: Component classes to snapshot into shared memory for
+        the job. If given, fn is called as fn(arrays, *args), where arrays has
+        a read-only component_array() for each class.
+    :returns: An entityx.jobs.Future, resolved during PythonSystem::update()
+        of the current world.
+    """
+    from entityx import jobs
+    return jobs.submit(fn, args, components)
+
 
 def emit(event):
     """Emit an event.
@@ -0,0 +1,247 @@
+"""Run pure-compute Python functions in a pool of forked worker processes.
+
+Jobs are submitted with entityx.submit(), and run without access to the
+world. Component arrays they need are copied into a shared memory file that
+the workers map read-only:
+
+    def plan_paths(arrays, goal):
+        positions, = arrays
+        ...
+        return paths
+
+    future = entityx.submit(plan_paths, (goal,), components=(Position,))
+    future.add_done_callback(lambda f: apply_paths(f.result()))
+
+Futures are resolved, and their callbacks called, on the main thread during
+PythonSystem::update() of the world that submitted them. Functions and arguments must be picklable, so jobs
+should be module-level functions.
+"""
+
+import mmap
+import multiprocessing
+import os
+import sys
+import tempfile
+import threading
+import time
+import traceback
+
+import _entityx
+
+
+__all__ = ['Future', 'start', 'submit', 'shutdown']
+
+
+class Future(object):
+    """The result of a job."""
+
+    def __init__(self, async_result, snapshot, world):
+        self._async_result = async_result
+        self._snapshot = snapshot
+        # The key of the submitting world, which resolves the future.
+        self._world = world
+        self._callbacks = []
+        self._done = False
+        self._result = None
+        self._exception = None
+
+    def done(self):
+        return self._done
+
+    def result(self):
+        """Return the result of the job, or raise its exception.
+
+        :raises RuntimeError: If the future has not been resolved yet.
+        """
+        if not self._done:
+            raise RuntimeError('job has not been resolved yet')
+        if self._exception is not None:
+            raise self._exception
+        return self._result
+
+    def exception(self):
+        return self._exception
+
+    def add_done_callback(self, fn):
+        """Call fn(future) once resolved, or now if already resolved."""
+        if self._done:
+            fn(self)
+        else:
+            self._callbacks.append(fn)
+
+    def _resolve(self):
+        try:
+            self._result = self._async_result.get()
+        except Exception as e:
+            self._exception = e
+        self._done = True
+        if self._snapshot is not None:
+            self._snapshot.release()
+            self._snapshot = None
+        callbacks, self._callbacks = self._callbacks, []
+        for fn in callbacks:
+            fn(self)
+
+
+class _Snapshot(object):
+    """Copies of component arrays in a shared memory file."""
+
+    def __init__(self, components):
+        arrays = [cls.component_array(_entityx._entity_manager) for cls in components]
+        self.path = None
+        self.layout = []
+        size = 0
+        for chunks in arrays:
+            entries = []
+            for first_index, view, mask in chunks:
+                entries.append((first_index, size, len(view), size + len(view), len(mask)))
+                size += len(view) + len(mask)
+            self.layout.append(entries)
+        if not size:
+            return
+        fd, self.path = tempfile.mkstemp(prefix='entityx-', dir=_shared_memory_dir())
+        try:
+            os.ftruncate(fd, size)
+            buf = mmap.mmap(fd, size)
+            for chunks, entries in zip(arrays, self.layout):
+                for (first_index, view, mask), (_, offset, length, mask_offset, mask_length) in zip(chunks, entries):
+                    buf[offset:offset + length] = view.tobytes()
+                    buf[mask_offset:mask_offset + mask_length] = bytes(mask)
+            buf.close()
+        finally:
+            os.close(fd)
+
+    def release(self):
+        if self.path is not None:
+            os.unlink(self.path)
+            self.path = None
+
+
+if sys.version_info[0] >= 3:
+    def _reraise(tp, value, tb):
+        raise value.with_traceback(tb)
+else:
+    exec('def _reraise(tp, value, tb):\n    raise tp, value, tb\n')
+
+
+def _shared_memory_dir():
+    return '/dev/shm' if os.path.isdir('/dev/shm') else None
+
+
+def _watch_parent(parent):
+    # Pool workers are not reaped if the embedding process exits without
+    # finalizing Python, so exit once reparented.
+    while os.getppid() == parent:
+        time.sleep(1.0)
+    os._exit(0)
+
+
+def _init_worker(parent):
+    watcher = threading.Thread(target=_watch_parent, args=(parent,))
+    watcher.daemon = True
+    watcher.start()
+
+
+def _map_snapshot(path):
+    with open(path, 'rb') as f:
+        buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    try:
+        return memoryview(buf)
+    except TypeError:
+        # Python 2's mmap does not support memoryview, so copy the snapshot.
+        view = memoryview(buf[:])
+        buf.close()
+        return view
+
+
+def _run(fn, args, path, layout):
+    if layout is None:
+        return fn(*args)
+    view = None
+    if path is not None:
+        view = _map_snapshot(path)
+    arrays = [[(first_index, view[offset:offset + length], view[mask_offset:mask_offset + mask_length])
+               for first_index, offset, length, mask_offset, mask_length in entries]
+              for entries in layout]
+    return fn(arrays, *args)
+
+
+class _Jobs(object):
+    def __init__(self, processes):
+        self._pool = multiprocessing.Pool(processes, _init_worker, (os.getpid(),))
+        self._pending = []
+
+    def submit(self, fn, args, components):
+        snapshot = _Snapshot(components) if components else None
+        layout = snapshot.layout if snapshot else None
+        path = snapshot.path if snapshot else None
+        result = self._pool.apply_async(_run, (fn, tuple(args), path, layout))
+        future = Future(result, snapshot, _entityx._world)
+        self._pending.append(future)
+        return future
+
+    def resolve(self, world):
+        """Resolve the futures of finished jobs submitted from world.
+
+        If callbacks raise, every finished future is still resolved. The first
+        exception is then raised, and any others are printed.
+        """
+        if not self._pending:
+            return
+        pending = self._pending
+        self._pending = []
+        error = None
+        for future in pending:
+            if future._world != world or not future._async_result.ready():
+                self._pending.append(future)
+                continue
+            try:
+                future._resolve()
+            except Exception:
+                if error is None:
+                    error = sys.exc_info()
+                else:
+                    traceback.print_exc()
+        if error is not None:
+            _reraise(*error)
+
+    def discard(self, world):
+        """Drop the futures of a destroyed world without resolving them."""
+        pending = self._pending
+        self._pending = []
+        for future in pending:
+            if future._world != world:
+                self._pending.append(future)
+            elif future._snapshot is not None:
+                future._snapshot.release()
+                future._snapshot = None
+
+    def close(self):
+        self._pool.terminate()
+        self._pool.join()
+        for future in self._pending:
+            if future._snapshot is not None:
+                future._snapshot.release()
+        self._pending = []
+
+
+def start(processes=None):
+    """Start the worker pool, with processes workers (default: one per CPU).
+
+    Called by submit() if necessary.
+    """
+    if _entityx._jobs is None:
+        _entityx._jobs = _Jobs(processes)
+    return _entityx._jobs
+
+
+def submit(fn, args=(), components=()):
+    """See entityx.submit()."""
+    return start().submit(fn, args, components)
+
+
+def shutdown():
+    """Stop the worker pool. Unresolved futures are never resolved."""
+    if _entityx._jobs is not None:
+        _entityx._jobs.close()
+        _entityx._jobs = None
@@ -0,0 +1,16 @@
+from entityx import BatchSystem
+from entityx_python_test import Position, Direction
+
+
+class MovementSystem(BatchSystem):
+    components = (Position, Direction)
+
+    def update(self, entities, dt):
+        for entity, position, direction in entities:
+            position.x += direction.x * dt
+            position.y += direction.y * dt
+
+
+class EmptySystem(BatchSystem):
+    def update(self, entities, dt):
+        assert entities is None
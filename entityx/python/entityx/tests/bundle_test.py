@@ -0,0 +1,32 @@
+import os
+import runpy
+import shutil
+import tempfile
+
+
+ENTITIES = '''from entityx import Entity
+
+
+class Bundled(Entity):
+    pass
+'''
+
+
+def make_bundle(script):
+    """Bundle a generated package, and remove its sources."""
+    source = tempfile.mkdtemp()
+    package = os.path.join(source, 'bundled_scripts')
+    os.mkdir(package)
+    open(os.path.join(package, '__init__.py'), 'w').close()
+    with open(os.path.join(package, 'entities.py'), 'w') as f:
+        f.write(ENTITIES)
+    output = os.path.join(source, 'scripts.zip')
+    runpy.run_path(script)['bundle'](output, [source])
+    shutil.rmtree(package)
+    return output
+
+
+def check_bundled(entity, bundle):
+    module = __import__('bundled_scripts.entities', fromlist=['Bundled'])
+    assert isinstance(entity, module.Bundled)
+    assert module.__file__.startswith(bundle), module.__file__
@@ -0,0 +1,14 @@
+import entityx
+from entityx_python_test import Health
+
+
+def damage_wounded():
+    for entity, health in entityx.entities_with(Health):
+        if health.health < 10:
+            health.health -= 1
+
+
+def construct_unassigned():
+    # Not in a pool, so not tracked.
+    health = Health(5)
+    health.health = 6
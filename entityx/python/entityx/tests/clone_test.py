@@ -0,0 +1,42 @@
+import entityx
+from entityx import Entity, Component
+from entityx_python_test import Position, Direction
+
+
+class Enemy(Entity):
+    position = Component(Position)
+    constructed = 0
+
+    def __init__(self):
+        Enemy.constructed += 1
+        self.hp = 100
+        self.position.x = 5
+
+
+class SlottedEnemy(Enemy):
+    __slots__ = ('armour',)
+    direction = Component(Direction)
+
+
+def clone_test():
+    prototype = Enemy()
+    prototype.hp = 50
+    clones = entityx.clone(prototype, 3)
+    assert len(clones) == 3, clones
+    assert Enemy.constructed == 1, Enemy.constructed
+    for clone in clones:
+        assert isinstance(clone, Enemy), clone
+        assert clone._entity_id != prototype._entity_id
+        assert clone.hp == 50, clone.hp
+        assert clone.position.x == 5, clone.position.x
+    clones[0].position.x = 1
+    assert prototype.position.x == 5, prototype.position.x
+
+    slotted = SlottedEnemy()
+    slotted.armour = 3
+    slotted.direction.y = 2
+    clone, = entityx.clone(slotted)
+    assert clone.armour == 3, clone.armour
+    assert clone.direction.y == 2, clone.direction.y
+    clone.direction.y = 1
+    assert slotted.direction.y == 2, slotted.direction.y
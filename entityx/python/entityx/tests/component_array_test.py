@@ -0,0 +1,14 @@
+import struct
+import entityx
+from entityx_python_test import Position
+
+
+def component_array_test(a, c):
+    (first, view, mask), = entityx.component_array(Position)
+    assert first == 0, first
+    size = len(view) // len(mask)
+    assert size == struct.calcsize('ff'), size
+    assert [i for i in range(c + 1) if mask[i]] == [a, c], list(mask[:c + 1])
+    assert struct.unpack_from('ff', view, a * size) == (1.0, 2.0)
+    assert struct.unpack_from('ff', view, c * size) == (3.0, 4.0)
+    struct.pack_into('ff', view, c * size, 5.0, 6.0)
@@ -0,0 +1,25 @@
+import _entityx
+from entityx import Entity, Component
+from entityx_python_test import Position, Direction
+
+
+victims = []
+
+
+class Victim(Entity):
+    def __init__(self):
+        victims.append(self)
+
+
+class DeferredTest(Entity):
+    position = Component(Position)
+
+    def update(self, dt):
+        em = _entityx._entity_manager
+        Direction(1, 2).assign_to(em, self._entity_id)
+        Position.remove_from(em, self._entity_id)
+        victims.pop().destroy()
+        # Nothing is applied until PythonSystem::update() returns.
+        assert Direction.get_component(em, self._entity_id) is None
+        assert Position.get_component(em, self._entity_id) is not None
+        assert len(_entityx._commands) == 3, len(_entityx._commands)
@@ -0,0 +1,27 @@
+import entityx
+from entityx_python_test import Position, Direction
+
+
+def entities_with_test(both, scripted):
+    rows = [(entity, position.x, direction.x)
+            for entity, position, direction in entityx.entities_with(Position, Direction)]
+    assert len(rows) == 2, rows
+    assert rows[0][0].id == both.id, rows
+    assert rows[0][1:] == (2.0, 3.0), rows
+    assert rows[1][0] is scripted, rows
+
+    assert len(list(entityx.entities_with(Position))) == 3
+
+    # Rows released by the caller are reused.
+    query = entityx.entities_with(Position)
+    row = next(query)
+    row_id = id(row)
+    del row
+    assert id(next(query)) == row_id
+
+    try:
+        entityx.entities_with(int)
+    except TypeError:
+        pass
+    else:
+        assert False, 'expected TypeError for an unregistered component'
@@ -0,0 +1,37 @@
+import entityx
+from entityx import Entity, Component
+from entityx_python_test import Health
+
+
+class HealthTest(Entity):
+    health = Component(Health, 50)
+
+    def test_fields(self):
+        assert self.health.health == 50, self.health.health
+        assert self.health.regeneration == 0.5, self.health.regeneration
+        assert self.health.alive is True, self.health.alive
+        self.health.health -= 10
+        self.health.regeneration = 1.5
+        self.health.alive = False
+        self.health.name = 'bob'
+        try:
+            self.health.health = 'lots'
+        except TypeError:
+            pass
+        else:
+            assert False, 'expected TypeError'
+        rows = list(entityx.entities_with(Health))
+        assert len(rows) == 1 and rows[0][0] is self, rows
+
+
+class HandleTest(Entity):
+    health = Component(Health)
+
+
+def expect_reference_error(health):
+    try:
+        health.health
+    except ReferenceError:
+        pass
+    else:
+        assert False, 'expected ReferenceError'
@@ -0,0 +1,12 @@
+import imp
+import sys
+
+import entityx
+
+
+def check_frozen():
+    assert imp.is_frozen('entityx'), entityx
+    assert imp.is_frozen('entityx.jobs')
+    assert entityx.__doc__, entityx.__doc__
+    # Subpackages are still imported from disk.
+    assert 'entityx.tests' in sys.modules
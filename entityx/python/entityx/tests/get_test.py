@@ -0,0 +1,7 @@
+import entityx
+
+
+def get_test(scripted, plain_id, destroyed_id):
+    assert entityx.get(scripted._entity_id) is scripted
+    assert entityx.get(plain_id) is None
+    assert entityx.get(destroyed_id) is None
@@ -0,0 +1,25 @@
+from entityx import Entity
+
+
+class Turret(Entity):
+    pass
+
+
+class BigTurret(Turret):
+    pass
+
+
+class Wall(Entity):
+    pass
+
+
+def check_instances(turrets, big_turrets, walls):
+    instances = Turret.instances()
+    assert all(isinstance(turret, Turret) for turret in instances), list(instances)
+    assert instances[-1] is instances[len(instances) - 1]
+    counts = len(instances), len(BigTurret.instances()), len(Wall.instances())
+    assert counts == (turrets, big_turrets, walls), counts
+
+
+def create_turret():
+    return Turret()
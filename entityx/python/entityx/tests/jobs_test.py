@@ -0,0 +1,47 @@
+import struct
+
+import entityx
+from entityx import jobs
+from entityx_python_test import Position
+
+
+def sum_x(arrays, scale):
+    total = 0.0
+    for first_index, view, mask in arrays[0]:
+        size = len(view) // len(mask)
+        for i, present in enumerate(bytearray(mask.tobytes())):
+            if present:
+                x, y = struct.unpack('ff', view[i * size:(i + 1) * size].tobytes())
+                total += x * scale
+    return total
+
+
+def fail():
+    raise ValueError('expected')
+
+
+def submit():
+    resolved = []
+    future = entityx.submit(sum_x, (2.0,), components=(Position,))
+    future.add_done_callback(resolved.append)
+    failed = entityx.submit(fail)
+    return future, failed, resolved
+
+
+def check(future, failed, resolved):
+    assert resolved == [future]
+    assert future.result() == 12.0, future.result()
+    assert isinstance(failed.exception(), ValueError)
+    jobs.shutdown()
+
+
+def identity(value):
+    return value
+
+
+def submit_counting():
+    # The callback records the number of Positions in the world it runs in.
+    seen = []
+    future = entityx.submit(identity, (1,))
+    future.add_done_callback(lambda f: seen.append(len(list(entityx.entities_with(Position)))))
+    return future, seen
@@ -0,0 +1,14 @@
+import entityx
+from entityx_python_test import Position, Direction
+
+
+def kernels_test():
+    entityx.kernels.integrate(Position, Direction, 0.5)
+    assert entityx.kernels.integrate is entityx.kernels.integrate
+
+    try:
+        entityx.kernels.missing
+    except AttributeError:
+        pass
+    else:
+        assert False, 'expected AttributeError for an unregistered kernel'
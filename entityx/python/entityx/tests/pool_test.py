@@ -0,0 +1,35 @@
+from entityx import Entity, Component
+from entityx_python_test import Position
+
+
+class PooledEntity(Entity):
+    _pool_size = 1
+    position = Component(Position)
+    resets = 0
+
+    def __init__(self, x):
+        self.position.x = x
+
+    def reset(self):
+        self.resets += 1
+
+
+class PooledSlotsEntity(Entity):
+    __slots__ = ('target',)
+    _pool_size = 1
+    position = Component(Position)
+    reset_target = None
+
+    def __init__(self, target):
+        self.target = target
+
+    def reset(self):
+        self.reset_target = self.target
+        self.target = None
+
+
+class FailingResetEntity(Entity):
+    _pool_size = 1
+
+    def reset(self):
+        raise ValueError('reset failed')
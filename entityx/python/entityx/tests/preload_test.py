@@ -0,0 +1,5 @@
+from entityx import Entity
+
+
+class PreloadTest(Entity):
+    pass
@@ -0,0 +1,32 @@
+import colorsys  # Not imported elsewhere, so loaded while profiling.
+import json
+import os
+
+from entityx import Entity
+
+
+class Profiled(Entity):
+    pass
+
+
+def find(nodes, name):
+    for node in nodes:
+        if node['name'] == name:
+            return node
+        found = find(node['children'], name)
+        if found:
+            return found
+
+
+def check_profile(path, python_path):
+    with open(path) as f:
+        roots = json.load(f)
+    os.remove(path)
+    names = [node['name'] for node in roots]
+    assert 'Py_Initialize' in names, names
+    configure = roots[names.index('configure')]
+    assert [node['name'] for node in configure['children']] == ['sys.path: ' + python_path], configure
+    module = find(roots, 'entityx.tests.profile_test')
+    assert module, roots
+    assert find(module['children'], 'colorsys'), module
+    assert module['ms'] >= find(module['children'], 'colorsys')['ms'], module
@@ -0,0 +1,69 @@
+import _entityx
+import entityx
+from entityx import Entity, Component, PythonComponent
+
+
+class Inventory(PythonComponent):
+    def __init__(self, capacity=10):
+        self.capacity = capacity
+        self.items = []
+
+    def __len__(self):
+        return len(self.items)
+
+
+class Tag(PythonComponent):
+    pass
+
+
+class PlayerTest(Entity):
+    inventory = Component(Inventory, 20)
+
+    def update(self, dt):
+        self.inventory.items.append('sword')
+
+
+def tag(entity_id):
+    Tag().assign_to(_entityx._entity_manager, entity_id)
+
+
+def python_component_test(player):
+    em = _entityx._entity_manager
+    assert Inventory.get_component(em, player._entity_id) is player.inventory
+    assert Tag.get_component(em, player._entity_id) is None
+
+    rows = list(entityx.entities_with(Inventory))
+    assert len(rows) == 1 and rows[0][0] is player, rows
+    assert rows[0][1] is player.inventory, rows
+    assert len(list(entityx.entities_with(Tag))) == 1
+
+    # Components are copied, not shared, by clones.
+    clone, = entityx.clone(player)
+    assert clone.inventory is not player.inventory
+    assert clone.inventory.items == player.inventory.items, clone.inventory.items
+
+    Inventory.remove_from(em, player._entity_id)
+    assert Inventory.get_component(em, player._entity_id) is None
+
+    try:
+        PythonComponent().assign_to(em, player._entity_id)
+    except TypeError:
+        pass
+    else:
+        assert False, 'expected TypeError for the PythonComponent base class'
+
+
+def make_component():
+    class Made(PythonComponent):
+        pass
+    return Made
+
+
+def redefinition_test(entity_id):
+    # Classes of the same name defined outside PythonSystem::reload() have
+    # their own families.
+    em = _entityx._entity_manager
+    first, second = make_component(), make_component()
+    first().assign_to(em, entity_id)
+    assert isinstance(first.get_component(em, entity_id), first)
+    assert second.get_component(em, entity_id) is None
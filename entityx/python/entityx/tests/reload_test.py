@@ -0,0 +1,86 @@
+import os
+import shutil
+import sys
+import tempfile
+
+
+VERSION_1 = '''from entityx import Entity, Component, PythonComponent, BatchSystem
+
+
+class Counter(PythonComponent):
+    def __init__(self):
+        self.value = 0
+
+
+class Reloaded(Entity):
+    __slots__ = ('owner',)
+    counter = Component(Counter)
+
+    def version(self):
+        return 1
+'''
+
+VERSION_2 = '''from entityx import Entity, Component, PythonComponent, BatchSystem
+
+
+class Counter(PythonComponent):
+    def __init__(self):
+        self.value = 0
+
+    def version(self):
+        return 2
+
+
+class Reloaded(Entity):
+    __slots__ = ('extra', 'owner')
+    counter = Component(Counter)
+
+    def version(self):
+        return 2
+
+    def on_collision(self, event):
+        self.collided = True
+'''
+
+
+def write_module(source):
+    """Write the reloadable module, and remove stale bytecode."""
+    directory = os.path.join(tempfile.gettempdir(), 'entityx_reload_test')
+    if directory not in sys.path:
+        if os.path.isdir(directory):
+            shutil.rmtree(directory)
+        os.mkdir(directory)
+        sys.path.insert(0, directory)
+    with open(os.path.join(directory, 'reloadable.py'), 'w') as f:
+        f.write(source)
+    for name in ('reloadable.pyc', '__pycache__'):
+        path = os.path.join(directory, name)
+        if os.path.isdir(path):
+            shutil.rmtree(path)
+        elif os.path.exists(path):
+            os.remove(path)
+
+
+def prepare(entity):
+    entity.hits = 3
+    entity.owner = 'bob'
+    entity.counter.value += 1
+    write_module(VERSION_2)
+
+
+def check_reloaded(entity, counter):
+    import reloadable
+    assert type(entity) is reloadable.Reloaded, type(entity)
+    assert entity.version() == 2
+    assert entity.hits == 3
+    assert entity.owner == 'bob'
+    try:
+        entity.extra
+    except AttributeError:
+        pass
+    else:
+        assert False, 'expected AttributeError'
+    assert type(entity.counter) is reloadable.Counter
+    assert entity.counter is counter
+    assert entity.counter.value == 1 and entity.counter.version() == 2
+    assert list(reloadable.Reloaded.instances()) == [entity]
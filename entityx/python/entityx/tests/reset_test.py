@@ -0,0 +1,6 @@
+from entityx import Entity, Component
+from entityx_python_test import Position
+
+
+class ResetTest(Entity):
+    position = Component(Position, 1, 2)
@@ -0,0 +1,40 @@
+from entityx import Entity, Component
+from entityx_python_test import Position, Direction
+
+
+class SlotsTest(Entity):
+    __slots__ = ('health',)
+    position = Component(Position, 1, 2)
+
+    def __init__(self):
+        self.health = 10
+
+    def test_slots(self):
+        assert self.position.x == 1.0, self.position.x
+        assert self.health == 10, self.health
+        self.health -= 1
+        assert self.health == 9, self.health
+        del self.health
+        try:
+            self.health
+        except AttributeError:
+            pass
+        else:
+            assert False, 'deleted slot is still set'
+        assert not self.__dict__, self.__dict__
+
+
+class SlotsSubclassTest(SlotsTest):
+    __slots__ = ('ammo',)
+    direction = Component(Direction, 3, 4)
+
+    def __init__(self):
+        SlotsTest.__init__(self)
+        self.ammo = 5
+
+    def test_slots_subclass(self):
+        assert self.position.x == 1.0, self.position.x
+        assert self.direction.x == 3.0, self.direction.x
+        assert self.health == 10, self.health
+        assert self.ammo == 5, self.ammo
+        assert not self.__dict__, self.__dict__
@@ -0,0 +1,25 @@
+import entityx
+from entityx import Entity, Component
+from entityx_python_test import Position
+
+
+class Child(Entity):
+    position = Component(Position)
+
+
+class Parent(Entity):
+    def __init__(self):
+        self.child = Child()
+        self.seen = 0
+
+    def update(self, dt):
+        self.seen = len(list(entityx.entities_with(Position)))
+
+
+def stale_query_test(query):
+    try:
+        next(query)
+    except RuntimeError:
+        pass
+    else:
+        assert False, 'expected RuntimeError for a destroyed world'